@@ -0,0 +1,321 @@
+//The transports defined here move halo rows between the processes of a distributed run (see distributed_solver.h).
+//Every process owns one horizontal band of the board and only ever talks to the processes owning the bands directly above and below it.
+//Two transports are provided: POSIX shared memory for processes on the same machine, and TCP (over loopback for local testing).
+//The multi-process mode currently only supports POSIX hosts, so everything here is compiled out on windows.
+
+#ifndef BAND_TRANSPORT_H
+#define BAND_TRANSPORT_H
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+//directions used when talking to neighbours
+const int HALO_ABOVE = -1;
+const int HALO_BELOW = 1;
+
+class HaloTransport {
+public:
+    virtual ~HaloTransport() {}
+
+    //false if the transport couldn't be set up (segment missing, connection refused...)
+    virtual bool ok() const = 0;
+    //sends count cells to the neighbour in the given direction. may block until the neighbour has taken the previous message.
+    //returns false if the neighbour is gone or doesn't respond, after which the run can't continue.
+    virtual bool send_rows(int direction, const unsigned int* cells, size_t count) = 0;
+    //blocks until count cells have arrived from the neighbour in the given direction. returns false on failure, like send_rows.
+    virtual bool receive_rows(int direction, unsigned int* cells, size_t count) = 0;
+};
+
+
+//shared memory transport. the segment holds two single message mailboxes (one per direction) for every band boundary.
+//sends and receives in different directions never touch the same mailbox, so one thread can send while another receives.
+//shared memory can't tell us when the other side has died, so waits give up after timeout_ms and report a failure.
+class ShmHaloTransport : public HaloTransport {
+public:
+    //bytes needed for a segment serving process_count processes that send at most capacity cells per message
+    static size_t segment_bytes(unsigned int process_count, size_t capacity) {
+        size_t boundaries = process_count > 1 ? process_count - 1 : 0;
+        return boundaries * 2 * mailbox_bytes(capacity);
+    }
+
+    //creates (or truncates) the named segment. should be called once, before any process constructs a transport on it.
+    static bool create_segment(const std::string& name, unsigned int process_count, size_t capacity) {
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600);
+        if (fd < 0) {
+            std::cout << "ERROR::SHM_TRANSPORT::COULD_NOT_CREATE_SEGMENT: " << name << std::endl;
+            return false;
+        }
+        bool ok = ftruncate(fd, (off_t)segment_bytes(process_count, capacity)) == 0;
+        close(fd);
+        return ok;
+    }
+
+    static void remove_segment(const std::string& name) {
+        shm_unlink(name.c_str());
+    }
+
+    ShmHaloTransport(const std::string& name, unsigned int rank, unsigned int process_count, size_t capacity, unsigned int timeout_ms = 30000)
+        : rank(rank), process_count(process_count), capacity(capacity), timeout_ms(timeout_ms), memory(nullptr) {
+        mapped_bytes = segment_bytes(process_count, capacity);
+        sent[0] = sent[1] = 0;
+        received[0] = received[1] = 0;
+        if (mapped_bytes == 0) {
+            return;
+        }
+        int fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0) {
+            std::cout << "ERROR::SHM_TRANSPORT::COULD_NOT_OPEN_SEGMENT: " << name << std::endl;
+            return;
+        }
+        void* mapping = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            std::cout << "ERROR::SHM_TRANSPORT::COULD_NOT_MAP_SEGMENT: " << name << std::endl;
+            return;
+        }
+        memory = (unsigned char*)mapping;
+    }
+
+    ~ShmHaloTransport() {
+        if (memory != nullptr) {
+            munmap(memory, mapped_bytes);
+        }
+    }
+
+    bool ok() const override {
+        return mapped_bytes == 0 || memory != nullptr;
+    }
+
+    bool send_rows(int direction, const unsigned int* cells, size_t count) override {
+        if (memory == nullptr || count > capacity) {
+            return false;
+        }
+        Mailbox box = mailbox(direction, true);
+        uint64_t& sequence = sent[direction > 0];
+        //wait for the neighbour to take the previous message
+        if (!wait_for(box.header->read, sequence, true)) {
+            std::cout << "ERROR::SHM_TRANSPORT::SEND_TIMED_OUT: rank " << rank << std::endl;
+            return false;
+        }
+        std::memcpy(box.payload, cells, sizeof(unsigned int) * count);
+        sequence++;
+        box.header->written.store(sequence, std::memory_order_release);
+        return true;
+    }
+
+    bool receive_rows(int direction, unsigned int* cells, size_t count) override {
+        if (memory == nullptr || count > capacity) {
+            return false;
+        }
+        Mailbox box = mailbox(direction, false);
+        uint64_t& sequence = received[direction > 0];
+        if (!wait_for(box.header->written, sequence, false)) {
+            std::cout << "ERROR::SHM_TRANSPORT::RECEIVE_TIMED_OUT: rank " << rank << std::endl;
+            return false;
+        }
+        std::memcpy(cells, box.payload, sizeof(unsigned int) * count);
+        sequence++;
+        box.header->read.store(sequence, std::memory_order_release);
+        return true;
+    }
+
+private:
+    //written and read live on separate cache lines since they are updated by different processes
+    struct MailboxHeader {
+        std::atomic<uint64_t> written;
+        char padding_1[64 - sizeof(std::atomic<uint64_t>)];
+        std::atomic<uint64_t> read;
+        char padding_2[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    struct Mailbox {
+        MailboxHeader* header;
+        unsigned int* payload;
+    };
+
+    unsigned int rank;
+    unsigned int process_count;
+    size_t capacity;
+    unsigned int timeout_ms;
+    size_t mapped_bytes;
+    unsigned char* memory;
+    uint64_t sent[2];       //messages sent above [0] and below [1]
+    uint64_t received[2];   //messages received from above [0] and below [1]
+
+    //spins until counter equals value (or stops equalling it, when until_equal is false). returns false if that takes longer than timeout_ms.
+    bool wait_for(const std::atomic<uint64_t>& counter, uint64_t value, bool until_equal) const {
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        unsigned int spins = 0;
+        while ((counter.load(std::memory_order_acquire) == value) != until_equal) {
+            std::this_thread::yield();
+            //only look at the clock every so often, it's much slower than the load
+            if (++spins % 1024 == 0 && std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static size_t mailbox_bytes(size_t capacity) {
+        return sizeof(MailboxHeader) + (((capacity * sizeof(unsigned int)) + 63) / 64) * 64;
+    }
+
+    //mailbox 0 of a boundary carries messages downwards (rank b to b + 1), mailbox 1 carries them upwards
+    Mailbox mailbox(int direction, bool sending) {
+        unsigned int boundary = direction > 0 ? rank : rank - 1;
+        bool downwards = (direction > 0) == sending;
+        unsigned char* base = memory + ((((size_t)boundary * 2) + (downwards ? 0 : 1)) * mailbox_bytes(capacity));
+        Mailbox box;
+        box.header = reinterpret_cast<MailboxHeader*>(base);
+        box.payload = reinterpret_cast<unsigned int*>(base + sizeof(MailboxHeader));
+        return box;
+    }
+};
+
+
+//TCP transport. every process keeps one connection to the process above and one to the process below.
+//rank r accepts the connection from rank r + 1 on its own listener and connects to the listener of rank r - 1.
+class TcpHaloTransport : public HaloTransport {
+public:
+    //opens a listening socket on the loopback interface. passing port 0 picks a free port, which is written to bound_port.
+    static int open_listener(unsigned short port, unsigned short* bound_port) {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) {
+            return -1;
+        }
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0) {
+            close(listener);
+            return -1;
+        }
+        socklen_t length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        if (bound_port != nullptr) {
+            *bound_port = ntohs(address.sin_port);
+        }
+        return listener;
+    }
+
+    //listener is this rank's listening socket (unused by the last rank), port_above is the port rank - 1 listens on (unused by rank 0)
+    TcpHaloTransport(unsigned int rank, unsigned int process_count, int listener, unsigned short port_above) {
+        sockets[0] = -1;
+        sockets[1] = -1;
+        //connect first: the listener above already exists, so this completes through its backlog without waiting for accept
+        if (rank > 0) {
+            sockets[0] = connect_to(port_above);
+        }
+        if (rank + 1 < process_count) {
+            sockets[1] = accept(listener, NULL, NULL);
+            set_no_delay(sockets[1]);
+        }
+        connected = !((rank > 0 && sockets[0] < 0) || (rank + 1 < process_count && sockets[1] < 0));
+        if (!connected) {
+            std::cout << "ERROR::TCP_TRANSPORT::COULD_NOT_CONNECT: rank " << rank << std::endl;
+        }
+    }
+
+    ~TcpHaloTransport() {
+        for (int i = 0; i < 2; i++) {
+            if (sockets[i] >= 0) {
+                close(sockets[i]);
+            }
+        }
+    }
+
+    bool ok() const override {
+        return connected;
+    }
+
+    bool send_rows(int direction, const unsigned int* cells, size_t count) override {
+        if (sockets[direction > 0] < 0) {
+            return false;
+        }
+        const char* data = (const char*)cells;
+        size_t remaining = sizeof(unsigned int) * count;
+        while (remaining > 0) {
+            ssize_t sent = send(sockets[direction > 0], data, remaining, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                std::cout << "ERROR::TCP_TRANSPORT::SEND_FAILED" << std::endl;
+                return false;
+            }
+            data += sent;
+            remaining -= (size_t)sent;
+        }
+        return true;
+    }
+
+    bool receive_rows(int direction, unsigned int* cells, size_t count) override {
+        if (sockets[direction > 0] < 0) {
+            return false;
+        }
+        char* data = (char*)cells;
+        size_t remaining = sizeof(unsigned int) * count;
+        while (remaining > 0) {
+            ssize_t received = recv(sockets[direction > 0], data, remaining, 0);
+            if (received <= 0) {
+                //a closed connection (received == 0) means the neighbour has exited or crashed
+                std::cout << "ERROR::TCP_TRANSPORT::RECEIVE_FAILED" << std::endl;
+                return false;
+            }
+            data += received;
+            remaining -= (size_t)received;
+        }
+        return true;
+    }
+
+private:
+    int sockets[2];     //connection to the process above [0] and below [1]
+    bool connected;
+
+    static void set_no_delay(int connection) {
+        //halo messages are latency bound, so don't let nagle hold them back
+        int flag = 1;
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+
+    static int connect_to(unsigned short port) {
+        int connection = socket(AF_INET, SOCK_STREAM, 0);
+        if (connection < 0) {
+            return -1;
+        }
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (connect(connection, (sockaddr*)&address, sizeof(address)) != 0) {
+            close(connection);
+            return -1;
+        }
+        set_no_delay(connection);
+        return connection;
+    }
+};
+
+#endif
+
+
+
+#endif
@@ -0,0 +1,165 @@
+//The functions defined here are small standalone benchmarks for the cpu side of the project.
+//They are run from main() before any window is created when RUN_BENCHMARKS is set, and simply print their timings to the console.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "tile_arena.h"
+#include "cpu_solver.h"
+#include "distributed_solver.h"
+#include "board_generators.h"
+
+
+//xorshift used to pick tiles in a fixed pseudo random order, so every run touches the same sequence of pages
+inline uint32_t benchmark_next_random(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+//walks tiles in a random order, reading one cell and writing another in each. with tiles spread over many small pages almost every
+//access is a TLB miss, so the difference between the two runs is mostly what huge page backing buys us.
+inline double benchmark_tile_walk(std::vector<TilePair>& tiles, size_t cells_per_tile, size_t accesses) {
+    uint32_t state = 2463534242u;
+    unsigned int sink = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < accesses; i++) {
+        TilePair& pair = tiles[benchmark_next_random(state) % tiles.size()];
+        size_t cell = benchmark_next_random(state) % cells_per_tile;
+        sink += pair.front[cell];
+        pair.back[cell] = sink;
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    //keep the loop from being optimized away
+    if (sink == 0xFFFFFFFFu) {
+        std::cout << sink;
+    }
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)accesses;
+}
+
+//compares tile pairs handed out by the tile arena against pairs allocated one at a time with new[]
+inline void benchmark_tile_arena() {
+    const size_t tile_side = 64;
+    const size_t cells_per_tile = tile_side * tile_side;
+    const size_t tile_count = 4096;         //4096 pairs of 64x64 tiles is 128MB, well past what the TLB can cover with 4KB pages
+    const size_t accesses = 20000000;
+
+    std::cout << "--- tile arena benchmark (" << tile_count << " pairs of " << tile_side << "x" << tile_side << " tiles) ---\n";
+
+    //heap allocated pairs
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<TilePair> heap_tiles(tile_count);
+    for (size_t i = 0; i < tile_count; i++) {
+        heap_tiles[i].front = new unsigned int[cells_per_tile]();
+        heap_tiles[i].back = new unsigned int[cells_per_tile]();
+    }
+    double heap_alloc_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double heap_ns = benchmark_tile_walk(heap_tiles, cells_per_tile, accesses);
+
+    //arena allocated pairs
+    TileArena arena(cells_per_tile);
+    start = std::chrono::steady_clock::now();
+    std::vector<TilePair> arena_tiles(tile_count);
+    for (size_t i = 0; i < tile_count; i++) {
+        arena_tiles[i] = arena.acquire();
+    }
+    double arena_alloc_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    double arena_ns = benchmark_tile_walk(arena_tiles, cells_per_tile, accesses);
+
+    //recycling through the free list is what a board that grows and shrinks every generation would do
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < tile_count; i++) {
+        arena.release(arena_tiles[i]);
+        arena_tiles[i] = arena.acquire();
+    }
+    double recycle_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "new[]:  alloc " << heap_alloc_ms << " ms, random tile access " << heap_ns << " ns\n";
+    std::cout << "arena:  alloc " << arena_alloc_ms << " ms, random tile access " << arena_ns << " ns, release+acquire all " << recycle_ms << " ms\n";
+    arena.print_stats();
+
+    for (size_t i = 0; i < tile_count; i++) {
+        delete[] heap_tiles[i].front;
+        delete[] heap_tiles[i].back;
+        arena.release(arena_tiles[i]);
+    }
+}
+
+//steps the same board with the cpu solver on one NUMA node and then on every node, to show how throughput scales across sockets
+inline void benchmark_numa_scaling() {
+    const unsigned int width = 4096;
+    const unsigned int height = 4096;
+    const unsigned int generations = 50;
+    LifeRule conway = { { 0, 0, 1, 1, 0, 0, 0, 0, 0 }, { 0, 0, 0, 1, 0, 0, 0, 0, 0 } };
+
+    std::vector<unsigned int> board((size_t)width * height);
+    generate_board(board.data(), width, height, make_board_generator("uniform", 88172645, 3));
+
+    size_t node_total = detect_numa_nodes().size();
+    std::cout << "--- numa scaling benchmark (" << width << "x" << height << ", " << generations << " generations, " << node_total << " nodes) ---\n";
+
+    double single_rate = 0.0;
+    for (unsigned int nodes = 1; nodes <= node_total; nodes++) {
+        CpuSolver solver(width, height, conway, nodes);
+        solver.load(board.data());
+        solver.step(1);     //warm up
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        solver.step(generations);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rate = ((double)width * height * generations) / seconds;
+        if (nodes == 1) {
+            single_rate = rate;
+        }
+        std::cout << nodes << " node(s), " << solver.thread_count() << " threads: " << (rate / 1e9) << " Gcells/s, "
+            << (generations / seconds) << " generations/s, " << (rate / single_rate) << "x\n";
+    }
+}
+
+#ifndef _WIN32
+//steps a board split over several local processes, for both transports and a few halo depths.
+//deeper halos mean fewer (but larger) exchanges at the cost of recomputing the overlap rows.
+inline void benchmark_distributed() {
+    const unsigned int width = 2048;
+    const unsigned int height = 2048;
+    const unsigned int generations = 64;
+    const unsigned int process_count = 4;
+    LifeRule conway = { { 0, 0, 1, 1, 0, 0, 0, 0, 0 }, { 0, 0, 0, 1, 0, 0, 0, 0, 0 } };
+
+    std::vector<unsigned int> board((size_t)width * height);
+    generate_board(board.data(), width, height, make_board_generator("uniform", 1234567, 3));
+
+    std::cout << "--- distributed benchmark (" << width << "x" << height << ", " << generations << " generations, " << process_count << " processes) ---\n";
+    const unsigned int halo_depths[] = { 1, 4, 16 };
+    for (int kind = 0; kind < 2; kind++) {
+        for (int d = 0; d < 3; d++) {
+            std::vector<unsigned int> cells = board;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            bool ok = run_distributed(cells.data(), width, height, conway, generations, process_count, (HaloTransportKind)kind, halo_depths[d]);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << (kind == TRANSPORT_SHARED_MEMORY ? "shared memory" : "tcp loopback") << ", halo depth " << halo_depths[d] << ": "
+                << (ok ? "" : "FAILED, ") << (generations / seconds) << " generations/s (including process startup)\n";
+        }
+    }
+}
+#endif
+
+inline void run_benchmarks() {
+    benchmark_tile_arena();
+    benchmark_numa_scaling();
+#ifndef _WIN32
+    benchmark_distributed();
+#endif
+}
+
+
+
+#endif
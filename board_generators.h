@@ -0,0 +1,255 @@
+//The generators defined here fill a board with a starting pattern. They replace the old commented out seeding code in main.cpp
+//(rand() soups, i % 16 stripes and concentric rings) with named, seeded generators that can be picked without editing any code.
+//Randomness comes from Philox4x32-10, a counter based generator: the random bits for a cell depend only on the seed and the cell's
+//coordinates, so a board is reproducible from its seed and can be filled by any number of threads in any order with the same result.
+
+#ifndef BOARD_GENERATORS_H
+#define BOARD_GENERATORS_H
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+//Philox4x32 with 10 rounds (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+struct Philox4x32 {
+    uint32_t value[4];
+};
+
+inline Philox4x32 philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t seed) {
+    const uint32_t M0 = 0xD2511F53u;
+    const uint32_t M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u;
+    const uint32_t W1 = 0xBB67AE85u;
+    uint32_t k0 = (uint32_t)seed;
+    uint32_t k1 = (uint32_t)(seed >> 32);
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t product_0 = (uint64_t)M0 * c0;
+        uint64_t product_1 = (uint64_t)M1 * c2;
+        uint32_t next_0 = (uint32_t)(product_1 >> 32) ^ c1 ^ k0;
+        uint32_t next_1 = (uint32_t)product_1;
+        uint32_t next_2 = (uint32_t)(product_0 >> 32) ^ c3 ^ k1;
+        uint32_t next_3 = (uint32_t)product_0;
+        c0 = next_0;
+        c1 = next_1;
+        c2 = next_2;
+        c3 = next_3;
+        k0 += W0;
+        k1 += W1;
+    }
+
+    Philox4x32 result = { { c0, c1, c2, c3 } };
+    return result;
+}
+
+//32 random bits for cell (x, y). stream lets one generator draw several independent values per cell.
+//each philox call gives four outputs, which are shared by four horizontally neighbouring cells.
+inline uint32_t cell_random(uint64_t seed, uint32_t x, uint32_t y, uint32_t stream) {
+    return philox4x32(x >> 2, y, stream, 0, seed).value[x & 3];
+}
+
+inline double to_unit_interval(uint32_t bits) {
+    return bits * (1.0 / 4294967296.0);
+}
+
+
+enum BoardPattern {
+    PATTERN_EMPTY,
+    PATTERN_UNIFORM,            //every cell is alive with probability 1 / density (the old rand() % gen_density soup)
+    PATTERN_STRIPES,            //a live column every period cells
+    PATTERN_RINGS,              //concentric rings around the centre of the board
+    PATTERN_SYMMETRIC_SOUP,     //random soup in a centred square, mirrored horizontally and vertically
+    PATTERN_CLUSTERED_NOISE     //patches of soup separated by empty space, shaped by smooth value noise
+};
+
+struct BoardGenerator {
+    BoardPattern pattern;
+    uint64_t seed;
+    unsigned int density;           //uniform, symmetric soup and clustered noise: cells are alive with probability 1 / density
+    unsigned int period;            //stripes: distance between live columns. rings: distance between rings
+    unsigned int thickness;         //rings: ring thickness in cells
+    unsigned int ring_count;        //rings: number of rings
+    unsigned int centre_radius;     //rings: radius of the filled disc in the middle (0 for none)
+    unsigned int size;              //symmetric soup: side of the soup square. clustered noise: approximate cluster size
+};
+
+//looks up a generator by name: "empty", "uniform", "stripes", "rings", "symmetric_soup" or "clustered_noise".
+//unknown names give an empty board. density is the gen_density that goes with the chosen rulestring in main.cpp.
+inline BoardGenerator make_board_generator(const std::string& name, uint64_t seed, unsigned int density) {
+    BoardGenerator generator;
+    generator.pattern = PATTERN_EMPTY;
+    generator.seed = seed;
+    generator.density = density > 0 ? density : 1;
+    generator.period = 16;
+    generator.thickness = 2;
+    generator.ring_count = 4;
+    generator.centre_radius = 20;
+    generator.size = 128;
+
+    if (name == "uniform") {
+        generator.pattern = PATTERN_UNIFORM;
+    }
+    else if (name == "stripes") {
+        generator.pattern = PATTERN_STRIPES;
+    }
+    else if (name == "rings") {
+        generator.pattern = PATTERN_RINGS;
+        generator.period = 100;
+    }
+    else if (name == "symmetric_soup") {
+        generator.pattern = PATTERN_SYMMETRIC_SOUP;
+    }
+    else if (name == "clustered_noise") {
+        generator.pattern = PATTERN_CLUSTERED_NOISE;
+        generator.size = 64;
+    }
+    return generator;
+}
+
+
+//random value in [0, 1) for a point of the clustered noise lattice. the lattice uses its own stream so it doesn't correlate with the per cell draws.
+inline double lattice_value(uint64_t seed, unsigned int lx, unsigned int ly) {
+    return to_unit_interval(philox4x32(lx, ly, 1, 0, seed).value[0]);
+}
+
+inline double smoothstep(double t) {
+    return t * t * (3.0 - 2.0 * t);
+}
+
+//fills row y of a width * height board. row points at the start of that row, so a process that only holds a band of the board
+//can generate just its own rows.
+inline void generate_board_row(unsigned int* row, unsigned int width, unsigned int height, const BoardGenerator& generator, unsigned int y) {
+    switch (generator.pattern) {
+    case PATTERN_UNIFORM:
+        for (unsigned int x = 0; x < width; x += 4) {
+            Philox4x32 block = philox4x32(x >> 2, y, 0, 0, generator.seed);
+            for (unsigned int lane = 0; lane < 4 && x + lane < width; lane++) {
+                row[x + lane] = block.value[lane] % generator.density == 0 ? 1 : 0;
+            }
+        }
+        break;
+
+    case PATTERN_STRIPES:
+        for (unsigned int x = 0; x < width; x++) {
+            row[x] = x % generator.period == 0 ? 1 : 0;
+        }
+        break;
+
+    case PATTERN_RINGS:
+        for (unsigned int x = 0; x < width; x++) {
+            //64 bit so the squared distance can't overflow on boards wider than ~65k cells
+            int64_t dx = (int64_t)x - (int64_t)(width / 2);
+            int64_t dy = (int64_t)y - (int64_t)(height / 2);
+            int64_t dist = (int64_t)std::sqrt((double)((dx * dx) + (dy * dy)));
+            unsigned int alive = 0;
+            if (dist > 0 && dist < (int64_t)generator.centre_radius) {
+                alive = 1;
+            }
+            for (unsigned int ring = 1; ring <= generator.ring_count; ring++) {
+                int64_t radius = (int64_t)ring * generator.period;
+                if (dist < radius && dist >= radius - (int64_t)generator.thickness) {
+                    alive = 1;
+                }
+            }
+            row[x] = alive;
+        }
+        break;
+
+    case PATTERN_SYMMETRIC_SOUP: {
+        unsigned int size = generator.size < width ? generator.size : width;
+        if (size > height) {
+            size = height;
+        }
+        unsigned int left = (width - size) / 2;
+        unsigned int top = (height - size) / 2;
+        for (unsigned int x = 0; x < width; x++) {
+            row[x] = 0;
+            if (x < left || x >= left + size || y < top || y >= top + size) {
+                continue;
+            }
+            //fold every cell onto the top left quadrant so mirrored cells draw the same random bits
+            unsigned int qx = x - left;
+            unsigned int qy = y - top;
+            if (qx >= size / 2) {
+                qx = size - 1 - qx;
+            }
+            if (qy >= size / 2) {
+                qy = size - 1 - qy;
+            }
+            row[x] = cell_random(generator.seed, qx, qy, 0) % generator.density == 0 ? 1 : 0;
+        }
+        break;
+    }
+
+    case PATTERN_CLUSTERED_NOISE: {
+        //smooth value noise on a lattice with spacing cells between points. only the top half of the noise range makes clusters,
+        //and they get denser towards their middle.
+        unsigned int spacing = generator.size > 0 ? generator.size : 1;
+        unsigned int ly = y / spacing;
+        double fy = smoothstep((double)(y % spacing) / spacing);
+        for (unsigned int lx = 0; lx * spacing < width; lx++) {
+            //the four lattice corners only change once per lattice cell, so look them up once per span
+            double top = lattice_value(generator.seed, lx, ly);
+            double top_right = lattice_value(generator.seed, lx + 1, ly);
+            double left = top + ((lattice_value(generator.seed, lx, ly + 1) - top) * fy);
+            double right = top_right + ((lattice_value(generator.seed, lx + 1, ly + 1) - top_right) * fy);
+
+            unsigned int span_end = (lx + 1) * spacing < width ? (lx + 1) * spacing : width;
+            for (unsigned int x = lx * spacing; x < span_end; x++) {
+                double noise = left + ((right - left) * smoothstep((double)(x % spacing) / spacing));
+                double chance = noise > 0.5 ? ((noise - 0.5) * 2.0) : 0.0;
+                chance = (chance * 2.0) / generator.density;
+                row[x] = to_unit_interval(cell_random(generator.seed, x, y, 0)) < chance ? 1 : 0;
+            }
+        }
+        break;
+    }
+
+    default:
+        for (unsigned int x = 0; x < width; x++) {
+            row[x] = 0;
+        }
+        break;
+    }
+}
+
+//fills rows [row_begin, row_end) of a width * height board
+inline void generate_board_rows(unsigned int* cells, unsigned int width, unsigned int height, const BoardGenerator& generator, unsigned int row_begin, unsigned int row_end) {
+    for (unsigned int y = row_begin; y < row_end; y++) {
+        generate_board_row(cells + ((size_t)y * width), width, height, generator, y);
+    }
+}
+
+//fills a whole width * height board, splitting the rows over thread_count threads (0 uses every cpu).
+//the result is identical for any thread count. cells can point straight into a mapped GL buffer.
+inline void generate_board(unsigned int* cells, unsigned int width, unsigned int height, const BoardGenerator& generator, unsigned int thread_count = 0) {
+    if (thread_count == 0) {
+        thread_count = std::thread::hardware_concurrency();
+    }
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    if (thread_count > height) {
+        thread_count = height > 0 ? height : 1;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < thread_count; t++) {
+        unsigned int row_begin = (unsigned int)(((unsigned long long)height * t) / thread_count);
+        unsigned int row_end = (unsigned int)(((unsigned long long)height * (t + 1)) / thread_count);
+        threads.push_back(std::thread(generate_board_rows, cells, width, height, std::cref(generator), row_begin, row_end));
+    }
+    //the calling thread takes the first slice
+    generate_board_rows(cells, width, height, generator, 0, (unsigned int)(height / thread_count));
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
+
+
+
+#endif
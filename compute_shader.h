@@ -5,8 +5,14 @@
 #define COMPUTE_SHADER_H
 
 // GLEW
+#ifndef NO_GLEW
 #define GLEW_STATIC
 #include <GL/glew.h>
+#else
+//headless builds (tools/differential_check_egl.cpp) call the core entry points exported by libOpenGL directly
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
 
 #include <string>
 #include <fstream>
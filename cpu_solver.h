@@ -0,0 +1,271 @@
+//The cpu solver defined here steps a life-like board on the cpu with exactly the same rules as cell_solver.computes,
+//including the dead boundary (cells outside the board always count as dead).
+//The board is split into horizontal bands, one per NUMA node. Each band lives in memory bound to its node, is stepped only by worker threads
+//pinned to that node's cpus, and the only data that crosses between nodes each generation are the halo rows along band boundaries.
+
+#ifndef CPU_SOLVER_H
+#define CPU_SOLVER_H
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tile_arena.h"
+#include "numa_topology.h"
+
+
+//a rulestring in the same form as the rule_survive/rule_birth uniforms: entry n is 1 if a cell with n live neighbours survives/is born
+struct LifeRule {
+    int survive[9];
+    int birth[9];
+};
+
+//steps rows [row_begin, row_end) of a buffer that is width cells wide. rows row_begin - 1 and row_end must exist in the buffer
+//(as halo rows if needed), columns outside [0, width) are treated as dead.
+//this is the cpu equivalent of one dispatch of cell_solver.computes over those rows.
+inline void cpu_step_rows(const unsigned int* in, unsigned int* out, unsigned int width, int row_begin, int row_end, const LifeRule& rule) {
+    for (int y = row_begin; y < row_end; y++) {
+        const unsigned int* up = in + ((long long)(y - 1) * width);
+        const unsigned int* mid = in + ((long long)y * width);
+        const unsigned int* down = in + ((long long)(y + 1) * width);
+        unsigned int* dest = out + ((long long)y * width);
+
+        //running sums of the three columns around x, so each cell only reads one new column
+        unsigned int left = 0;
+        unsigned int centre = (up[0] != 0) + (mid[0] != 0) + (down[0] != 0);
+        for (unsigned int x = 0; x < width; x++) {
+            unsigned int right = 0;
+            if (x + 1 < width) {
+                right = (up[x + 1] != 0) + (mid[x + 1] != 0) + (down[x + 1] != 0);
+            }
+            unsigned int alive = mid[x] != 0;
+            unsigned int tally = left + centre + right - alive;
+            if (alive) {
+                dest[x] = rule.survive[tally] == 0 ? 0 : 1;
+            }
+            else {
+                dest[x] = rule.birth[tally] == 1 ? 1 : 0;
+            }
+            left = centre;
+            centre = right;
+        }
+    }
+}
+
+
+//reusable barrier for a fixed number of threads
+class ThreadBarrier {
+public:
+    ThreadBarrier(unsigned int count) : count(count), waiting(0), generation(0) {}
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(barrier_mutex);
+        unsigned long long arrival_generation = generation;
+        waiting++;
+        if (waiting == count) {
+            waiting = 0;
+            generation++;
+            barrier_cv.notify_all();
+        }
+        else {
+            barrier_cv.wait(lock, [&] { return generation != arrival_generation; });
+        }
+    }
+
+private:
+    std::mutex barrier_mutex;
+    std::condition_variable barrier_cv;
+    unsigned int count;
+    unsigned int waiting;
+    unsigned long long generation;
+};
+
+
+class CpuSolver {
+public:
+    //node_limit caps how many NUMA nodes are used (0 uses all of them), threads_per_node caps the workers per node (0 uses every cpu of the node)
+    CpuSolver(unsigned int width, unsigned int height, const LifeRule& rule, unsigned int node_limit = 0, unsigned int threads_per_node = 0)
+        : CpuSolver(width, height, rule, limit_nodes(detect_numa_nodes(), node_limit), threads_per_node) {}
+
+    //bands are laid out over the given nodes. passing the same node several times splits the board into more bands than there are nodes,
+    //which is handy for exercising the halo exchange on a single socket machine.
+    CpuSolver(unsigned int width, unsigned int height, const LifeRule& rule, std::vector<NumaNode> nodes, unsigned int threads_per_node)
+        : width(width), height(height), rule(rule), parity(0), pending_generations(0), shutting_down(false) {
+        if (nodes.size() > height) {
+            nodes.resize(height);
+        }
+
+        //bands are split as evenly as possible by row
+        unsigned int worker_count = 0;
+        for (size_t n = 0; n < nodes.size(); n++) {
+            Band band;
+            band.node = nodes[n];
+            band.row_begin = (unsigned int)((height * n) / nodes.size());
+            band.row_end = (unsigned int)((height * (n + 1)) / nodes.size());
+            band.worker_count = (unsigned int)band.node.cpus.size();
+            if (threads_per_node > 0 && threads_per_node < band.worker_count) {
+                band.worker_count = threads_per_node;
+            }
+            //each buffer holds the band's rows plus one halo row above and below
+            band.arena = new TileArena((size_t)(band.rows() + 2) * width, band.node.id);
+            band.buffers[0] = nullptr;
+            band.buffers[1] = nullptr;
+            bands.push_back(band);
+            worker_count += band.worker_count;
+        }
+
+        work_barrier = new ThreadBarrier(worker_count);
+        control_barrier = new ThreadBarrier(worker_count + 1);
+
+        for (size_t b = 0; b < bands.size(); b++) {
+            for (unsigned int w = 0; w < bands[b].worker_count; w++) {
+                workers.push_back(std::thread(&CpuSolver::worker_loop, this, (unsigned int)b, w));
+            }
+        }
+        //wait for every band's buffers to be allocated by its own (pinned) threads
+        control_barrier->wait();
+    }
+
+    ~CpuSolver() {
+        shutting_down = true;
+        control_barrier->wait();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        for (size_t b = 0; b < bands.size(); b++) {
+            TilePair pair = { bands[b].buffers[0], bands[b].buffers[1] };
+            bands[b].arena->release(pair);
+            delete bands[b].arena;
+        }
+        delete work_barrier;
+        delete control_barrier;
+    }
+
+    CpuSolver(const CpuSolver&) = delete;
+    CpuSolver& operator=(const CpuSolver&) = delete;
+
+    void set_rule(const LifeRule& new_rule) {
+        rule = new_rule;
+    }
+
+    //copies a full board (width * height cells, row major like cells_buff_1) into the solver
+    void load(const unsigned int* cells) {
+        for (size_t b = 0; b < bands.size(); b++) {
+            Band& band = bands[b];
+            std::memcpy(band.buffers[parity] + width, cells + ((size_t)band.row_begin * width), sizeof(unsigned int) * band.rows() * width);
+        }
+    }
+
+    //copies the current board out into a width * height array
+    void store(unsigned int* cells) const {
+        for (size_t b = 0; b < bands.size(); b++) {
+            const Band& band = bands[b];
+            std::memcpy(cells + ((size_t)band.row_begin * width), band.buffers[parity] + width, sizeof(unsigned int) * band.rows() * width);
+        }
+    }
+
+    //advances the board by the given number of generations
+    void step(unsigned int generations = 1) {
+        pending_generations = generations;
+        control_barrier->wait();    //release the workers
+        control_barrier->wait();    //wait for them to finish
+        parity = (parity + generations) % 2;
+    }
+
+    unsigned int band_count() const {
+        return (unsigned int)bands.size();
+    }
+
+    unsigned int thread_count() const {
+        return (unsigned int)workers.size();
+    }
+
+private:
+    struct Band {
+        NumaNode node;
+        unsigned int row_begin;
+        unsigned int row_end;
+        unsigned int worker_count;
+        TileArena* arena;
+        unsigned int* buffers[2];
+
+        unsigned int rows() const {
+            return row_end - row_begin;
+        }
+    };
+
+    unsigned int width;
+    unsigned int height;
+    LifeRule rule;
+    unsigned int parity;                //which of the two buffers of every band holds the current state
+    unsigned int pending_generations;
+    bool shutting_down;
+
+    std::vector<Band> bands;
+    std::vector<std::thread> workers;
+    ThreadBarrier* work_barrier;
+    ThreadBarrier* control_barrier;
+
+    static std::vector<NumaNode> limit_nodes(std::vector<NumaNode> nodes, unsigned int node_limit) {
+        if (node_limit > 0 && node_limit < nodes.size()) {
+            nodes.resize(node_limit);
+        }
+        return nodes;
+    }
+
+    void worker_loop(unsigned int band_index, unsigned int worker_index) {
+        Band& band = bands[band_index];
+        pin_current_thread(band.node, band.node.cpus[worker_index % band.node.cpus.size()]);
+
+        //the first worker of each band allocates the band, so it's first touched from the right node even where binding isn't available
+        if (worker_index == 0) {
+            TilePair pair = band.arena->acquire();
+            band.buffers[0] = pair.front;
+            band.buffers[1] = pair.back;
+        }
+        control_barrier->wait();
+
+        //rows of the band this worker is responsible for, offset by one for the halo row
+        int row_begin = 1 + (int)((band.rows() * worker_index) / band.worker_count);
+        int row_end = 1 + (int)((band.rows() * (worker_index + 1)) / band.worker_count);
+
+        while (true) {
+            control_barrier->wait();
+            if (shutting_down) {
+                return;
+            }
+
+            unsigned int local_parity = parity;
+            for (unsigned int g = 0; g < pending_generations; g++) {
+                unsigned int* in = band.buffers[local_parity];
+                unsigned int* out = band.buffers[1 - local_parity];
+
+                //pull the neighbouring bands' edge rows into our halo rows. the outer halo rows of the board stay zero (dead boundary).
+                if (worker_index == 0) {
+                    if (band_index > 0) {
+                        const Band& above = bands[band_index - 1];
+                        std::memcpy(in, above.buffers[local_parity] + ((size_t)above.rows() * width), sizeof(unsigned int) * width);
+                    }
+                    if (band_index + 1 < bands.size()) {
+                        const Band& below = bands[band_index + 1];
+                        std::memcpy(in + ((size_t)(band.rows() + 1) * width), below.buffers[local_parity] + width, sizeof(unsigned int) * width);
+                    }
+                }
+                work_barrier->wait();
+
+                cpu_step_rows(in, out, width, row_begin, row_end, rule);
+                work_barrier->wait();
+
+                local_parity = 1 - local_parity;
+            }
+
+            control_barrier->wait();
+        }
+    }
+};
+
+
+
+#endif
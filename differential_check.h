@@ -0,0 +1,328 @@
+//The differential check defined here runs random boards through every solver we have and compares the results against a straight port of
+//cell_solver.computes (including its dead boundary). Random rules, seeds, board sizes and generation counts are drawn for every case, results
+//are compared by board hash, and any mismatch is shrunk down to a small failing board that gets printed to the console.
+//Solvers are plugged in as DifferentialEngines: the cpu ones live here, the compute shader one is in gpu_engine.h.
+
+#ifndef DIFFERENTIAL_CHECK_H
+#define DIFFERENTIAL_CHECK_H
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpu_solver.h"
+#include "distributed_solver.h"
+#include "board_generators.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+
+//a solver under test. run steps board (width * height cells, row major) in place and returns false if the solver couldn't run at all.
+//run_generated (optional) builds the starting board itself from the case's generator and writes the result into board. it's used instead
+//of run for as long as the case board is still exactly what its generator made, which stops being true once shrinking edits the board.
+struct DifferentialEngine {
+    std::string name;
+    std::function<bool(std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations)> run;
+    std::function<bool(const BoardGenerator& generator, std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations)> run_generated;
+};
+
+struct DifferentialCase {
+    unsigned int width;
+    unsigned int height;
+    LifeRule rule;
+    unsigned int generations;
+    std::vector<unsigned int> board;
+    bool generated;                 //board is still generate_board(generator), untouched by shrinking
+    BoardGenerator generator;
+};
+
+
+//one generation exactly as cell_solver.computes does it: neighbour states outside the board are skipped and the rest are summed
+inline void reference_step(const std::vector<unsigned int>& in, std::vector<unsigned int>& out, unsigned int width, unsigned int height, const LifeRule& rule) {
+    for (int y = 0; y < (int)height; y++) {
+        for (int x = 0; x < (int)width; x++) {
+            unsigned int tally = 0;
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    int nx = x - 1 + i;
+                    int ny = y - 1 + j;
+                    if (nx >= 0 && nx < (int)width && ny >= 0 && ny < (int)height && !(nx == x && ny == y)) {
+                        tally += in[nx + (ny * width)];
+                    }
+                }
+            }
+            unsigned int index = x + (y * width);
+            if (in[index] > 0) {
+                out[index] = rule.survive[tally] == 0 ? 0 : 1;
+            }
+            else {
+                out[index] = rule.birth[tally] == 1 ? 1 : 0;
+            }
+        }
+    }
+}
+
+inline void reference_run(std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+    std::vector<unsigned int> next(board.size());
+    for (unsigned int g = 0; g < generations; g++) {
+        reference_step(board, next, width, height, rule);
+        board.swap(next);
+    }
+}
+
+//64 bit FNV-1a over the board size and cells
+inline uint64_t board_hash(const std::vector<unsigned int>& board, unsigned int width, unsigned int height) {
+    uint64_t hash = 14695981039346656037ull;
+    unsigned int header[2] = { width, height };
+    for (int i = 0; i < 2; i++) {
+        hash = (hash ^ header[i]) * 1099511628211ull;
+    }
+    for (size_t i = 0; i < board.size(); i++) {
+        hash = (hash ^ board[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+inline std::string rule_string(const LifeRule& rule) {
+    std::string result = "B";
+    for (int i = 0; i < 9; i++) {
+        if (rule.birth[i] == 1) {
+            result += (char)('0' + i);
+        }
+    }
+    result += "/S";
+    for (int i = 0; i < 9; i++) {
+        if (rule.survive[i] != 0) {
+            result += (char)('0' + i);
+        }
+    }
+    return result;
+}
+
+
+//the cpu solvers, in the configurations most likely to break: several bands per node, uneven band sizes, deep halos
+inline std::vector<DifferentialEngine> cpu_differential_engines() {
+    std::vector<DifferentialEngine> engines;
+
+    DifferentialEngine single_band;
+    single_band.name = "cpu_solver (1 band, 1 thread)";
+    single_band.run = [](std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+        CpuSolver solver(width, height, rule, single_numa_node(), 1);
+        solver.load(board.data());
+        solver.step(generations);
+        solver.store(board.data());
+        return true;
+    };
+    engines.push_back(single_band);
+
+    DifferentialEngine many_bands;
+    many_bands.name = "cpu_solver (3 bands, 2 threads each)";
+    many_bands.run = [](std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+        std::vector<NumaNode> nodes(3, single_numa_node()[0]);
+        CpuSolver solver(width, height, rule, nodes, 2);
+        solver.load(board.data());
+        solver.step(generations);
+        solver.store(board.data());
+        return true;
+    };
+    engines.push_back(many_bands);
+
+#ifndef _WIN32
+    const unsigned int process_counts[] = { 3, 2 };
+    const unsigned int halo_depths[] = { 1, 3 };
+    for (int kind = 0; kind < 2; kind++) {
+        DifferentialEngine distributed;
+        unsigned int processes = process_counts[kind];
+        unsigned int halo_depth = halo_depths[kind];
+        distributed.name = std::string("distributed (") + (kind == TRANSPORT_SHARED_MEMORY ? "shared memory" : "tcp") + ", "
+            + std::to_string(processes) + " processes, halo depth " + std::to_string(halo_depth) + ")";
+        distributed.run = [kind, processes, halo_depth](std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+            //no clamp here: small boards with more processes than rows have to go through run_distributed's own handling
+            return run_distributed(board.data(), width, height, rule, generations, processes, (HaloTransportKind)kind, halo_depth);
+        };
+        engines.push_back(distributed);
+    }
+
+    //the path for boards too big for one process: every process generates only its own rows and saves only its own final rows (here into
+    //a shared mapping, so they can be compared), nothing ever holds the whole board
+    DifferentialEngine generated_bands;
+    generated_bands.name = "distributed (shared memory, 4 processes, halo depth 2, bands generated and saved per process)";
+    generated_bands.run_generated = [](const BoardGenerator& generator, std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+        size_t board_bytes = sizeof(unsigned int) * board.size();
+        void* shared = mmap(NULL, board_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (shared == MAP_FAILED) {
+            return false;
+        }
+        unsigned int* result = (unsigned int*)shared;
+        BandSaver save = [result](const unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end) {
+            (void)height;
+            std::memcpy(result + ((size_t)row_begin * width), band, sizeof(unsigned int) * (row_end - row_begin) * width);
+            return true;
+        };
+        bool ok = run_distributed(width, height, rule, generations, 4, TRANSPORT_SHARED_MEMORY, 2, generator_band_loader(generator), save);
+        if (ok) {
+            std::memcpy(board.data(), result, board_bytes);
+        }
+        munmap(shared, board_bytes);
+        return ok;
+    };
+    engines.push_back(generated_bands);
+#endif
+
+    return engines;
+}
+
+
+//true if the engine disagrees with the reference on this case (or fails to run it).
+//an engine with only run_generated can't say anything about a board that shrinking has edited, so those never count as mismatches.
+inline bool differential_mismatch(const DifferentialEngine& engine, const DifferentialCase& test) {
+    std::vector<unsigned int> expected = test.board;
+    reference_run(expected, test.width, test.height, test.rule, test.generations);
+    std::vector<unsigned int> actual;
+    bool ran;
+    if (test.generated && engine.run_generated) {
+        actual.assign(test.board.size(), 0);
+        ran = engine.run_generated(test.generator, actual, test.width, test.height, test.rule, test.generations);
+    }
+    else if (engine.run) {
+        actual = test.board;
+        ran = engine.run(actual, test.width, test.height, test.rule, test.generations);
+    }
+    else {
+        return false;
+    }
+    if (!ran) {
+        return true;
+    }
+    return board_hash(actual, test.width, test.height) != board_hash(expected, test.width, test.height);
+}
+
+//removes one row or column from the edge of a board
+inline DifferentialCase crop_case(const DifferentialCase& test, int edge) {
+    DifferentialCase cropped = test;
+    cropped.generated = false;
+    unsigned int skip_x = edge == 2 ? 1 : 0;
+    unsigned int skip_y = edge == 0 ? 1 : 0;
+    cropped.width = test.width - (edge >= 2 ? 1 : 0);
+    cropped.height = test.height - (edge < 2 ? 1 : 0);
+    cropped.board.assign((size_t)cropped.width * cropped.height, 0);
+    for (unsigned int y = 0; y < cropped.height; y++) {
+        for (unsigned int x = 0; x < cropped.width; x++) {
+            cropped.board[x + (y * cropped.width)] = test.board[(x + skip_x) + ((y + skip_y) * test.width)];
+        }
+    }
+    return cropped;
+}
+
+//greedily shrinks a failing case while it keeps failing: fewer generations, then smaller boards, then fewer live cells
+inline DifferentialCase shrink_case(const DifferentialEngine& engine, DifferentialCase test) {
+    bool progress = true;
+    while (progress) {
+        progress = false;
+
+        while (test.generations > 1) {
+            DifferentialCase candidate = test;
+            candidate.generations = test.generations / 2;
+            if (!differential_mismatch(engine, candidate)) {
+                candidate.generations = test.generations - 1;
+                if (!differential_mismatch(engine, candidate)) {
+                    break;
+                }
+            }
+            test = candidate;
+            progress = true;
+        }
+
+        //edges: 0 top, 1 bottom, 2 left, 3 right
+        for (int edge = 0; edge < 4; edge++) {
+            while ((edge < 2 ? test.height : test.width) > 1) {
+                DifferentialCase candidate = crop_case(test, edge);
+                if (!differential_mismatch(engine, candidate)) {
+                    break;
+                }
+                test = candidate;
+                progress = true;
+            }
+        }
+
+        for (size_t i = 0; i < test.board.size(); i++) {
+            if (test.board[i] == 0) {
+                continue;
+            }
+            DifferentialCase candidate = test;
+            candidate.board[i] = 0;
+            candidate.generated = false;
+            if (differential_mismatch(engine, candidate)) {
+                test = candidate;
+                progress = true;
+            }
+        }
+    }
+    return test;
+}
+
+inline void print_case(const DifferentialCase& test) {
+    std::cout << "rule " << rule_string(test.rule) << ", " << test.width << "x" << test.height << ", " << test.generations << " generations, starting board:\n";
+    for (unsigned int y = 0; y < test.height; y++) {
+        for (unsigned int x = 0; x < test.width; x++) {
+            std::cout << (test.board[x + (y * test.width)] > 0 ? 'o' : '.');
+        }
+        std::cout << "\n";
+    }
+}
+
+//draws case_index of a run. everything comes from philox, so a case can be replayed from the run seed and its index alone.
+inline DifferentialCase random_case(uint64_t seed, unsigned int case_index, unsigned int max_size, unsigned int max_generations) {
+    Philox4x32 draw = philox4x32(case_index, 0, 2, 0, seed);
+    Philox4x32 rule_bits = philox4x32(case_index, 1, 2, 0, seed);
+
+    DifferentialCase test;
+    //mostly small boards, which shrink quickly, with the odd one at full size
+    test.width = 1 + (draw.value[0] % (case_index % 8 == 0 ? max_size : (max_size / 4) + 1));
+    test.height = 1 + (draw.value[1] % (case_index % 8 == 1 ? max_size : (max_size / 4) + 1));
+    test.generations = draw.value[2] % (max_generations + 1);
+    for (int i = 0; i < 9; i++) {
+        test.rule.survive[i] = (rule_bits.value[0] >> i) & 1;
+        test.rule.birth[i] = (rule_bits.value[1] >> i) & 1;
+    }
+
+    test.board.resize((size_t)test.width * test.height);
+    test.generated = true;
+    test.generator = make_board_generator("uniform", ((uint64_t)draw.value[3] << 32) | case_index, 2 + (draw.value[3] % 6));
+    generate_board(test.board.data(), test.width, test.height, test.generator, 1);
+    return test;
+}
+
+//runs case_count random cases through every engine and returns how many engine/case pairs disagreed with the reference
+inline unsigned int run_differential_check(const std::vector<DifferentialEngine>& engines, unsigned int case_count, uint64_t seed,
+    unsigned int max_size = 96, unsigned int max_generations = 24) {
+    std::cout << "--- differential check: " << case_count << " cases, " << engines.size() << " engines, seed " << seed << " ---\n";
+    unsigned int failures = 0;
+    for (size_t e = 0; e < engines.size(); e++) {
+        unsigned int engine_failures = 0;
+        for (unsigned int c = 0; c < case_count; c++) {
+            DifferentialCase test = random_case(seed, c, max_size, max_generations);
+            if (!differential_mismatch(engines[e], test)) {
+                continue;
+            }
+            engine_failures++;
+            //only shrink the first failure of each engine, the rest are usually the same bug
+            if (engine_failures == 1) {
+                std::cout << engines[e].name << " MISMATCH on case " << c << ", shrinking...\n";
+                print_case(shrink_case(engines[e], test));
+            }
+        }
+        std::cout << engines[e].name << ": " << (case_count - engine_failures) << "/" << case_count << " cases match\n";
+        failures += engine_failures;
+    }
+    return failures;
+}
+
+
+
+#endif
@@ -0,0 +1,416 @@
+//The distributed solver defined here steps one horizontal band of a board that is split across several processes.
+//Each process only holds its own rows plus halo_depth halo rows above and below. Every halo_depth generations the edge rows are swapped with
+//the neighbouring processes through a HaloTransport, and the band is then stepped halo_depth times without talking to anyone (temporal blocking).
+//Sends run on a separate thread, so the interior of the band is computed while the halo rows are in flight.
+//Rules and the dead boundary are the same as cell_solver.computes and the cpu solver.
+
+#ifndef DISTRIBUTED_SOLVER_H
+#define DISTRIBUTED_SOLVER_H
+
+#ifndef _WIN32
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "cpu_solver.h"
+#include "band_transport.h"
+#include "board_generators.h"
+
+
+class DistributedSolver {
+public:
+    //every band needs at least one row, so process_count must not be larger than height (run_distributed takes care of this)
+    DistributedSolver(unsigned int width, unsigned int height, const LifeRule& rule, unsigned int rank, unsigned int process_count, HaloTransport* transport, unsigned int halo_depth = 1)
+        : width(width), height(height), rule(rule), rank(rank), process_count(process_count), transport(transport),
+          halo_depth(halo_depth > 0 ? halo_depth : 1), parity(0), send_pending(false), send_failed(false), shutting_down(false) {
+        if (process_count == 0 || process_count > height) {
+            std::cout << "ERROR::DISTRIBUTED::TOO_MANY_PROCESSES: " << process_count << " processes for " << height << " rows" << std::endl;
+            throw std::invalid_argument("DistributedSolver: process_count must be between 1 and height");
+        }
+        row_begin = (unsigned int)(((unsigned long long)height * rank) / process_count);
+        row_end = (unsigned int)(((unsigned long long)height * (rank + 1)) / process_count);
+        //a band can't hand out more rows than it has, so the halo depth is capped by the smallest band
+        unsigned int smallest_band = height / process_count;
+        if (this->halo_depth > smallest_band) {
+            this->halo_depth = smallest_band;
+        }
+
+        buffer_rows = rows() + (2 * this->halo_depth);
+        arena = new TileArena((size_t)buffer_rows * width);
+        TilePair pair = arena->acquire();
+        buffers[0] = pair.front;
+        buffers[1] = pair.back;
+        send_staging.resize((size_t)2 * this->halo_depth * width);
+
+        sender = std::thread(&DistributedSolver::send_loop, this);
+    }
+
+    ~DistributedSolver() {
+        {
+            std::unique_lock<std::mutex> lock(send_mutex);
+            send_cv.wait(lock, [&] { return !send_pending; });
+            shutting_down = true;
+        }
+        send_cv.notify_all();
+        sender.join();
+        TilePair pair = { buffers[0], buffers[1] };
+        arena->release(pair);
+        delete arena;
+    }
+
+    DistributedSolver(const DistributedSolver&) = delete;
+    DistributedSolver& operator=(const DistributedSolver&) = delete;
+
+    unsigned int first_row() const {
+        return row_begin;
+    }
+
+    unsigned int rows() const {
+        return row_end - row_begin;
+    }
+
+    //this process's rows (rows() * width cells, starting at board row first_row()). they can be filled in before the first step
+    //and read after the last one, but the pointer changes with every generation.
+    unsigned int* band_cells() {
+        return buffers[parity] + ((size_t)halo_depth * width);
+    }
+
+    //advances the band by the given number of generations. every process of the run must call this with the same count.
+    //returns false if halo rows couldn't be exchanged, in which case the band is no longer valid.
+    bool step(unsigned int generations) {
+        while (generations > 0) {
+            unsigned int block = generations < halo_depth ? generations : halo_depth;
+            if (!step_block(block)) {
+                return false;
+            }
+            generations -= block;
+        }
+        //make sure the last sends actually went out before reporting success
+        std::unique_lock<std::mutex> lock(send_mutex);
+        send_cv.wait(lock, [&] { return !send_pending; });
+        return !send_failed;
+    }
+
+private:
+    unsigned int width;
+    unsigned int height;
+    LifeRule rule;
+    unsigned int rank;
+    unsigned int process_count;
+    HaloTransport* transport;
+    unsigned int halo_depth;
+
+    unsigned int row_begin;
+    unsigned int row_end;
+    unsigned int buffer_rows;       //rows() plus the halo rows on both sides
+    TileArena* arena;
+    unsigned int* buffers[2];
+    unsigned int parity;
+
+    std::vector<unsigned int> send_staging;     //edge rows waiting to go out: the top halo_depth rows, then the bottom halo_depth rows
+    std::thread sender;
+    std::mutex send_mutex;
+    std::condition_variable send_cv;
+    bool send_pending;
+    bool send_failed;
+    bool shutting_down;
+
+    bool has_above() const {
+        return rank > 0;
+    }
+
+    bool has_below() const {
+        return rank + 1 < process_count;
+    }
+
+    void send_loop() {
+        size_t halo_cells = (size_t)halo_depth * width;
+        while (true) {
+            std::unique_lock<std::mutex> lock(send_mutex);
+            send_cv.wait(lock, [&] { return send_pending || shutting_down; });
+            if (shutting_down) {
+                return;
+            }
+            lock.unlock();
+
+            bool sent = true;
+            if (has_above()) {
+                sent = transport->send_rows(HALO_ABOVE, send_staging.data(), halo_cells);
+            }
+            if (sent && has_below()) {
+                sent = transport->send_rows(HALO_BELOW, send_staging.data() + halo_cells, halo_cells);
+            }
+
+            lock.lock();
+            if (!sent) {
+                send_failed = true;
+            }
+            send_pending = false;
+            send_cv.notify_all();
+        }
+    }
+
+    //steps rows [first, last) of the buffers, clamped to rows that are part of the board
+    void step_range(unsigned int* in, unsigned int* out, int first, int last) {
+        //halo rows past the top or bottom of the board never hold live cells, they stand in for the dead boundary
+        if (!has_above() && first < (int)halo_depth) {
+            first = (int)halo_depth;
+        }
+        if (!has_below() && last > (int)(halo_depth + rows())) {
+            last = (int)(halo_depth + rows());
+        }
+        if (first < last) {
+            cpu_step_rows(in, out, width, first, last, rule);
+        }
+    }
+
+    bool step_block(unsigned int block) {
+        size_t halo_cells = (size_t)halo_depth * width;
+        unsigned int* current = buffers[parity];
+
+        //hand our edge rows to the sender thread (once it's done with the last batch)
+        {
+            std::unique_lock<std::mutex> lock(send_mutex);
+            send_cv.wait(lock, [&] { return !send_pending; });
+            if (send_failed) {
+                return false;
+            }
+            std::memcpy(send_staging.data(), current + halo_cells, sizeof(unsigned int) * halo_cells);
+            std::memcpy(send_staging.data() + halo_cells, current + ((size_t)rows() * width), sizeof(unsigned int) * halo_cells);
+            send_pending = true;
+        }
+        send_cv.notify_all();
+
+        //the first generation of the block: rows whose neighbourhood lies entirely inside our own rows can go before the halos arrive
+        int own_first = (int)halo_depth;
+        int own_last = (int)(halo_depth + rows());
+        int full_first = 1;
+        int full_last = (int)buffer_rows - 1;
+        int interior_first = own_first + 1;
+        int interior_last = own_last - 1 > interior_first ? own_last - 1 : interior_first;
+
+        unsigned int* in = buffers[parity];
+        unsigned int* out = buffers[1 - parity];
+        step_range(in, out, interior_first, interior_last);
+
+        if (has_above() && !transport->receive_rows(HALO_ABOVE, in, halo_cells)) {
+            return false;
+        }
+        if (has_below() && !transport->receive_rows(HALO_BELOW, in + ((size_t)own_last * width), halo_cells)) {
+            return false;
+        }
+        step_range(in, out, full_first, interior_first);
+        step_range(in, out, interior_last, full_last);
+        parity = 1 - parity;
+
+        //the rest of the block. the valid region shrinks by a row on each side every generation, and after block generations
+        //it has shrunk down to exactly our own rows.
+        for (unsigned int g = 1; g < block; g++) {
+            in = buffers[parity];
+            out = buffers[1 - parity];
+            step_range(in, out, 1 + (int)g, (int)buffer_rows - 1 - (int)g);
+            parity = 1 - parity;
+        }
+        return true;
+    }
+};
+
+
+//selects which transport run_distributed uses between its processes
+enum HaloTransportKind {
+    TRANSPORT_SHARED_MEMORY,
+    TRANSPORT_TCP
+};
+
+//called in every process before the first step to fill in its rows [row_begin, row_end). band holds (row_end - row_begin) * width cells.
+typedef std::function<void(unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end)> BandLoader;
+//called in every process after the last step with its final rows, e.g. to save them. returns false if that failed.
+typedef std::function<bool(const unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end)> BandSaver;
+
+//a loader that generates each band straight from a board generator, so no process ever holds more than its own rows
+inline BandLoader generator_band_loader(const BoardGenerator& generator) {
+    return [generator](unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end) {
+        for (unsigned int y = row_begin; y < row_end; y++) {
+            generate_board_row(band + ((size_t)(y - row_begin) * width), width, height, generator, y);
+        }
+    };
+}
+
+//kills and reaps every child that is still running
+inline void stop_children(std::vector<pid_t>& children) {
+    for (size_t i = 0; i < children.size(); i++) {
+        if (children[i] > 0) {
+            kill(children[i], SIGKILL);
+            waitpid(children[i], NULL, 0);
+            children[i] = 0;
+        }
+    }
+}
+
+//steps a width * height board for the given number of generations across process_count forked processes on this machine, one band each.
+//every process loads its own rows with load and hands its final rows to save (which may be empty), so the board never has to exist
+//in one piece. process_count is capped at height so every band gets at least one row.
+//returns false if any of the processes failed, in which case the rest are stopped.
+inline bool run_distributed(unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations, unsigned int process_count,
+    HaloTransportKind kind, unsigned int halo_depth, const BandLoader& load, const BandSaver& save) {
+    if (width == 0 || height == 0 || process_count == 0) {
+        return false;
+    }
+    if (process_count > height) {
+        process_count = height;
+    }
+    if (halo_depth == 0) {
+        halo_depth = 1;
+    }
+    if (halo_depth > height / process_count) {
+        halo_depth = height / process_count;
+    }
+    size_t halo_cells = (size_t)halo_depth * width;
+
+    //set up the transport before forking so every child can find it
+    std::string segment_name = "/lifelike_halo_" + std::to_string(getpid());
+    std::vector<int> listeners(process_count, -1);
+    std::vector<unsigned short> ports(process_count, 0);
+    bool ok = true;
+    if (kind == TRANSPORT_SHARED_MEMORY) {
+        ok = ShmHaloTransport::create_segment(segment_name, process_count, halo_cells);
+    }
+    else {
+        for (unsigned int r = 0; r < process_count && ok; r++) {
+            listeners[r] = TcpHaloTransport::open_listener(0, &ports[r]);
+            ok = listeners[r] >= 0;
+        }
+    }
+
+    //anything still buffered would otherwise be printed again by every child
+    std::cout.flush();
+    fflush(stdout);
+
+    std::vector<pid_t> children;
+    for (unsigned int r = 0; r < process_count && ok; r++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cout << "ERROR::DISTRIBUTED::FORK_FAILED: rank " << r << std::endl;
+            ok = false;
+            break;
+        }
+        if (pid == 0) {
+            //the child must never get back into the caller's code (it would carry on as a second copy of the program), so anything
+            //thrown here, from the solver, the arena or the load and save callbacks, ends the child as a failure
+            try {
+                HaloTransport* transport;
+                if (kind == TRANSPORT_SHARED_MEMORY) {
+                    transport = new ShmHaloTransport(segment_name, r, process_count, halo_cells);
+                }
+                else {
+                    transport = new TcpHaloTransport(r, process_count, listeners[r], r > 0 ? ports[r - 1] : 0);
+                }
+                //any failure here means our band (and our neighbours') can't be trusted, so the exit code has to say so
+                if (!transport->ok()) {
+                    _exit(1);
+                }
+                bool stepped;
+                {
+                    DistributedSolver solver(width, height, rule, r, process_count, transport, halo_depth);
+                    unsigned int row_end = solver.first_row() + solver.rows();
+                    if (load) {
+                        load(solver.band_cells(), width, height, solver.first_row(), row_end);
+                    }
+                    stepped = solver.step(generations);
+                    if (stepped && save) {
+                        stepped = save(solver.band_cells(), width, height, solver.first_row(), row_end);
+                    }
+                }
+                delete transport;
+                _exit(stepped ? 0 : 1);
+            }
+            catch (...) {
+                _exit(1);
+            }
+        }
+        children.push_back(pid);
+    }
+
+    //reap the children as they finish. as soon as one fails its neighbours can never complete, so stop everyone rather than
+    //leave them waiting on it.
+    size_t running = children.size();
+    while (ok && running > 0) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i] == pid) {
+                children[i] = 0;
+                running--;
+            }
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ok = false;
+        }
+    }
+    stop_children(children);
+
+    if (kind == TRANSPORT_SHARED_MEMORY) {
+        ShmHaloTransport::remove_segment(segment_name);
+    }
+    for (unsigned int r = 0; r < process_count; r++) {
+        if (listeners[r] >= 0) {
+            close(listeners[r]);
+        }
+    }
+    return ok;
+}
+
+//convenience version for boards that fit in memory: every process loads its rows from board, and the result is gathered back into it
+inline bool run_distributed(unsigned int* board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations,
+    unsigned int process_count, HaloTransportKind kind, unsigned int halo_depth = 1) {
+    size_t board_bytes = sizeof(unsigned int) * width * height;
+    if (board_bytes == 0) {
+        return false;
+    }
+
+    //the bands are gathered into a shared mapping that every child can write its rows into
+    void* shared = mmap(NULL, board_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        std::cout << "ERROR::DISTRIBUTED::COULD_NOT_MAP_RESULT_BOARD" << std::endl;
+        return false;
+    }
+    unsigned int* result = (unsigned int*)shared;
+
+    BandLoader load = [board](unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end) {
+        (void)height;
+        std::memcpy(band, board + ((size_t)row_begin * width), sizeof(unsigned int) * (row_end - row_begin) * width);
+    };
+    BandSaver save = [result](const unsigned int* band, unsigned int width, unsigned int height, unsigned int row_begin, unsigned int row_end) {
+        (void)height;
+        std::memcpy(result + ((size_t)row_begin * width), band, sizeof(unsigned int) * (row_end - row_begin) * width);
+        return true;
+    };
+
+    bool ok = run_distributed(width, height, rule, generations, process_count, kind, halo_depth, load, save);
+    if (ok) {
+        std::memcpy(board, result, board_bytes);
+    }
+    munmap(shared, board_bytes);
+    return ok;
+}
+
+#endif
+
+
+
+#endif
@@ -0,0 +1,79 @@
+//The gpu engine defined here lets the differential check in differential_check.h run boards through cell_solver.computes itself,
+//dispatched and ping-ponged the same way the main loop does it. It needs a current GL 4.3 context.
+//tools/differential_check_egl.cpp runs it headless on linux, including without a gpu under Mesa's llvmpipe (LIBGL_ALWAYS_SOFTWARE=1).
+
+#ifndef GPU_ENGINE_H
+#define GPU_ENGINE_H
+
+#include <memory>
+#include <vector>
+
+// GLEW
+#ifndef NO_GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+#else
+//headless builds (tools/differential_check_egl.cpp) call the core entry points exported by libOpenGL directly
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+#include "compute_shader.h"
+#include "differential_check.h"
+
+
+inline DifferentialEngine gpu_compute_engine(const char* shader_path = "cell_solver.computes") {
+    std::shared_ptr<ComputeShader> shader(new ComputeShader(shader_path));
+
+    DifferentialEngine engine;
+    engine.name = std::string("gpu (") + shader_path + ")";
+    engine.run = [shader](std::vector<unsigned int>& board, unsigned int width, unsigned int height, const LifeRule& rule, unsigned int generations) {
+        GLsizeiptr board_bytes = sizeof(unsigned int) * board.size();
+        //clear out any error left over from before, so the check at the end only reports our own
+        while (glGetError() != GL_NO_ERROR) {
+        }
+
+        GLuint cells_buffers[2];
+        glGenBuffers(2, cells_buffers);
+        for (int i = 0; i < 2; i++) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, cells_buffers[i]);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, board_bytes, i == 0 ? board.data() : nullptr, GL_DYNAMIC_COPY);
+        }
+
+        //the shader also draws into an image. it stores row y at height - y, so the texture needs one spare row.
+        GLuint image;
+        glGenTextures(1, &image);
+        glBindTexture(GL_TEXTURE_2D, image);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height + 1, 0, GL_RGBA, GL_FLOAT, NULL);
+        glBindImageTexture(0, image, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
+
+        //cell_size is fixed at 1 so the grid is exactly width x height
+        glProgramUniform1ui(shader->programID, glGetUniformLocation(shader->programID, "window_width"), width);
+        glProgramUniform1ui(shader->programID, glGetUniformLocation(shader->programID, "window_height"), height);
+        glProgramUniform1ui(shader->programID, glGetUniformLocation(shader->programID, "cell_size"), 1);
+        glProgramUniform1iv(shader->programID, glGetUniformLocation(shader->programID, "rule_survive"), 9, rule.survive);
+        glProgramUniform1iv(shader->programID, glGetUniformLocation(shader->programID, "rule_birth"), 9, rule.birth);
+
+        shader->use();
+        for (unsigned int g = 0; g < generations; g++) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cells_buffers[g % 2]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, cells_buffers[1 - (g % 2)]);
+            glDispatchCompute(width, height, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+        //the readback below goes through the buffer update path, which GL_SHADER_STORAGE_BARRIER_BIT doesn't cover
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, cells_buffers[generations % 2]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, board_bytes, board.data());
+
+        glDeleteTextures(1, &image);
+        glDeleteBuffers(2, cells_buffers);
+        return glGetError() == GL_NO_ERROR;
+    };
+    return engine;
+}
+
+
+
+#endif
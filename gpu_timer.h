@@ -0,0 +1,124 @@
+//The gpu timer defined here measures how long the gpu actually spends on a stage (the time spent in glDispatchCompute or glDrawElements on the cpu
+//is only the time to queue the work). It uses GL_TIME_ELAPSED queries and feeds the results into the profiler from profiler.h on a "gpu" track.
+//Query results are read back a few frames later and only once they are available, so timing never stalls the pipeline.
+//Like the rest of the profiler this compiles to nothing unless ENABLE_PROFILING is defined.
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILING
+
+// GLEW
+#ifndef NO_GLEW
+#define GLEW_STATIC
+#include <GL/glew.h>
+#else
+//headless builds (tools/differential_check_egl.cpp) call the core entry points exported by libOpenGL directly
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#endif
+
+
+class GpuStageTimer {
+public:
+    static const int FRAMES_IN_FLIGHT = 4;
+
+    GpuStageTimer(const char* name) : name(name), current(0), running(false), released(false) {
+        glGenQueries(FRAMES_IN_FLIGHT, queries);
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            pending[i] = false;
+            issued_ns[i] = 0;
+        }
+        track = gpu_track();
+    }
+
+    ~GpuStageTimer() {
+        release();
+    }
+
+    //deletes the query objects. must be called while the GL context is still current, i.e. before the window is destroyed.
+    void release() {
+        if (!released) {
+            glDeleteQueries(FRAMES_IN_FLIGHT, queries);
+            released = true;
+        }
+    }
+
+    //only one GL_TIME_ELAPSED query can be active at a time, so gpu stages must not be nested
+    void begin() {
+        if (released) {
+            return;
+        }
+        collect();
+        //if the query from FRAMES_IN_FLIGHT frames ago still isn't done, skip this frame rather than wait on it
+        if (pending[current]) {
+            return;
+        }
+        issued_ns[current] = Profiler::instance().now_ns();
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+        running = true;
+    }
+
+    void end() {
+        if (!running) {
+            return;
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        running = false;
+        current = (current + 1) % FRAMES_IN_FLIGHT;
+    }
+
+private:
+    const char* name;
+    GLuint queries[FRAMES_IN_FLIGHT];
+    bool pending[FRAMES_IN_FLIGHT];
+    uint64_t issued_ns[FRAMES_IN_FLIGHT];   //cpu time the stage was queued at, used to place the gpu event on the trace timeline
+    int current;
+    bool running;
+    bool released;
+    ProfileEventBuffer* track;
+
+    //every gpu timer shares one track
+    static ProfileEventBuffer* gpu_track() {
+        static ProfileEventBuffer* shared_track = Profiler::instance().create_buffer("gpu");
+        return shared_track;
+    }
+
+    void collect() {
+        for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+            if (!pending[i]) {
+                continue;
+            }
+            GLint available = 0;
+            glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+                track->push(name, issued_ns[i], (uint64_t)elapsed);
+                pending[i] = false;
+            }
+        }
+    }
+};
+
+
+#define PROFILE_GPU_TIMER(timer, name) GpuStageTimer timer(name)
+#define PROFILE_GPU_BEGIN(timer) timer.begin()
+#define PROFILE_GPU_END(timer) timer.end()
+#define PROFILE_GPU_RELEASE(timer) timer.release()
+
+#else
+
+#define PROFILE_GPU_TIMER(timer, name)
+#define PROFILE_GPU_BEGIN(timer)
+#define PROFILE_GPU_END(timer)
+#define PROFILE_GPU_RELEASE(timer)
+
+#endif
+
+
+
+#endif
@@ -4,6 +4,9 @@
 #include <vector>
 #include <windows.h>
 
+//uncomment to time the stages of the main loop (see profiler.h). a rolling summary is printed to the console and trace.json is written on exit.
+//#define ENABLE_PROFILING
+
 // GLEW
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -19,6 +22,12 @@
 //shader header
 #include "shader.h"
 #include "compute_shader.h"
+#include "benchmark.h"
+#include "board_generators.h"
+#include "differential_check.h"
+#include "gpu_engine.h"
+#include "profiler.h"
+#include "gpu_timer.h"
 
 //CALLBACK FUNCTIONS
 void error_callback(int, const char*);
@@ -47,6 +56,18 @@ const unsigned int DISPLAY_MODE = 1;
 //0: normal rendering for life-like automata
 //1: rendering for life-like automata with an added maximum age constraint (uses separate shader for simplicity)
 
+//set to true to run the cpu benchmarks in benchmark.h and exit instead of opening a window
+const bool RUN_BENCHMARKS = false;
+
+//set to true to check every solver (cpu, multi-process and the compute shader) against a reference on random boards and exit.
+//the gpu part needs the GL context, so this runs right after GL is set up.
+const bool RUN_DIFFERENTIAL_CHECK = false;
+
+//starting board settings
+const char* START_PATTERN = "empty";
+const uint64_t START_SEED = 1;
+//options for start pattern: empty, uniform, stripes, rings, symmetric_soup, clustered_noise (see board_generators.h)
+
 
 //define some vertices and indices which will be used to display fully rendered textures to our window
 float window_vertices[] = {
@@ -65,6 +86,11 @@ unsigned int window_indices[] = {
 
 
 int main() {
+	if (RUN_BENCHMARKS) {
+		run_benchmarks();
+		return 0;
+	}
+
 	//---------------------------------------------------------------------------------------------------
 	//GLFW AND GLEW INITILIZATION. THIS INCLUDES SETTING UP OUR WINDOW AND LINKING CALLBACK FUNCTIONS.
 	//---------------------------------------------------------------------------------------------------
@@ -100,6 +126,15 @@ int main() {
 	//set our update interval (argument is number of frames per update)
 	glfwSwapInterval(0);
 
+	if (RUN_DIFFERENTIAL_CHECK) {
+		std::vector<DifferentialEngine> engines = cpu_differential_engines();
+		engines.push_back(gpu_compute_engine("cell_solver.computes"));
+		unsigned int failures = run_differential_check(engines, 200, 1);
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		return failures == 0 ? 0 : 1;
+	}
+
 
 	//---------------------------------------------------------------------------------------------------
 	//SHADER PROGRAM CREATION
@@ -295,93 +330,21 @@ int main() {
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cells_buff_1);
 
 
-	//RANDOM CODE THAT WAS USED TO GENERATE INTERESTING STARTING BOARDS
+	//STARTING BOARD
 	//-----------------------------------------------------------------------------------------------------------------------------------------------------------
-	// 
-	//for (int i = 0; i < (window_height / cell_size) * (window_width / cell_size); i++) {
-		//if (rand() % gen_density > 0) {
-		//if ((int)(2*(rand() / (RAND_MAX + 1.0))) > 0) {
-		//if(i % 16 > 0){
-			//if (i / 540 < 1) {
-			//	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &zero);
-			//}
-			//else {
-			//	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &one);
-			//}
-
-			//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &zero);
-		//}
-		//else {
-			//if (i / 540 < 1) {
-			//	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &one);
-			//}
-			//else {
-			//	glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &zero);
-			//}
-
-			//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &one);
-		//}
-
-		//if (i % window_width < 960) {
-		//	if (i % 16 > 0) {
-		//		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &zero);
-		//	}
-		//	else {
-		//		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &one);
-		//	}
-		//}
-		//else {
-		//	if (i % 16 < 15) {
-		//		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &zero);
-		//	}
-		//	else {
-		//		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * i, sizeof(unsigned int), &one);
-		//	}
-		//}
-	//}
-	
-	//int dist;
-	//for (int i = 0; i < (window_width / cell_size); i++) {
-		//for (int j = 0; j < (window_height / cell_size); j++) {
-			//dist = sqrt(pow((int)(i - ((window_width / cell_size) / 2)), 2) + pow((int)(j - ((window_height / cell_size) / 2)), 2));
-			//if ((dist < 400) && (dist > 397)) {
-				//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//}
-			//else if ((dist < 300) && (dist > 297)) {
-				//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//}
-			//else if ((dist < 200) && (dist > 197)) {
-				//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//}
-			//else if ((dist < 100) && (dist > 97)) {
-				//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//}
-			//else if ((dist < 20) && (dist > 0)) {
-				//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//}
-
-			//else if ((dist < 200) && (dist > 196)) {
-			//	if ((((i - ((window_width / cell_size) / 2)) > 50) && ((i - ((window_width / cell_size) / 2)) < -50)) && (((j - ((window_height / cell_size) / 2)) > 50) && ((j - ((window_height / cell_size) / 2)) < -50))) {
-			//		glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * (i + (j * (window_width / cell_size))), sizeof(unsigned int), &one);
-			//	}
-			//}
-		//}
-	//}
-
-
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((window_width / 2) / cell_size) + ((int)((window_height / 2) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * 96, sizeof(unsigned int), &one);
-
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((window_width / 4) / cell_size) + ((int)((window_height / 2) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)(((window_width / 4) * 3) / cell_size) + ((int)((window_height / 2) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-
-
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((window_width / 4) / cell_size) + ((int)((window_height / 4) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)(((window_width / 4) * 3) / cell_size) + ((int)((window_height / 4) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((window_width / 4) / cell_size) + ((int)(((window_height / 4) * 3) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-	//glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)(((window_width / 4) * 3) / cell_size) + ((int)(((window_height / 4) * 3) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
-
-
+	//the starting board is generated straight into cells_buff_1 (see board_generators.h for the available patterns).
+	//uniform uses gen_density from the chosen rulestring above, and the same START_SEED always gives the same board.
+	BoardGenerator start_generator = make_board_generator(START_PATTERN, START_SEED, gen_density);
+	if (start_generator.pattern != PATTERN_EMPTY) {
+		unsigned int* start_cells = (unsigned int*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, sizeof(unsigned int) * (window_height / cell_size) * (window_width / cell_size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (start_cells != NULL) {
+			generate_board(start_cells, window_width / cell_size, window_height / cell_size, start_generator);
+			glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+		}
+		else {
+			std::cout << "ERROR: Could not map cells_buff_1 to generate the starting board!\n";
+		}
+	}
 	//-----------------------------------------------------------------------------------------------------------------------------------------------------------
 
 
@@ -392,6 +355,10 @@ int main() {
 	int cursor_width = 15; //size of square drawn and erased when clicking during runtime
 
 	int tempy = 0;
+
+	//gpu side timers for the two stages that do real work on the gpu (compiled out unless ENABLE_PROFILING is defined)
+	PROFILE_GPU_TIMER(gpu_dispatch_timer, "gpu_dispatch");
+	PROFILE_GPU_TIMER(gpu_draw_timer, "gpu_draw");
 	//---------------------------------------------------------------------------------------------------
 	//MAIN PROGRAM LOOP
 	//---------------------------------------------------------------------------------------------------
@@ -421,42 +388,58 @@ int main() {
 		}
 
 		//decide which shader program to use based on DISPLAY_MODE, and dispatch our compute shaders
-		if (DISPLAY_MODE == 0) {
-			cell_shader.use();
-			glDispatchCompute(window_width / cell_size, window_height / cell_size, 1);
-		}
-		else if (DISPLAY_MODE == 1) {
-			cell_shader_age.use();
-			glDispatchCompute(window_width / cell_size, window_height / cell_size, 1);
+		{
+			PROFILE_SCOPE("dispatch");
+			PROFILE_GPU_BEGIN(gpu_dispatch_timer);
+			if (DISPLAY_MODE == 0) {
+				cell_shader.use();
+				glDispatchCompute(window_width / cell_size, window_height / cell_size, 1);
+			}
+			else if (DISPLAY_MODE == 1) {
+				cell_shader_age.use();
+				glDispatchCompute(window_width / cell_size, window_height / cell_size, 1);
+			}
+			PROFILE_GPU_END(gpu_dispatch_timer);
 		}
 
-		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		{
+			PROFILE_SCOPE("memory_barrier");
+			glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+		}
 		
 
 
 
 
 		//display the computed image to the window
-		texture_shader.use();
-		glBindTexture(GL_TEXTURE_2D, output_texture);
-		glBindVertexArray(VAO_texture);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		{
+			PROFILE_SCOPE("draw");
+			PROFILE_GPU_BEGIN(gpu_draw_timer);
+			texture_shader.use();
+			glBindTexture(GL_TEXTURE_2D, output_texture);
+			glBindVertexArray(VAO_texture);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			PROFILE_GPU_END(gpu_draw_timer);
+		}
 
 
 		//handles mouse input, allowing user to draw and erase cells on the board
-		if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
-			glfwGetCursorPos(window, &xpos, &ypos);
-			for (int i = 0 - ((int)(cursor_width / 2)); i < (int)((cursor_width + 1) / 2); i++) {
-				for (int j = 0 - ((int)(cursor_width / 2)); j < (int)((cursor_width + 1) / 2); j++) {
-					glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int)* ((int)((xpos + i) / cell_size) + ((int)((ypos + j) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
+		{
+			PROFILE_SCOPE("brush");
+			if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS) {
+				glfwGetCursorPos(window, &xpos, &ypos);
+				for (int i = 0 - ((int)(cursor_width / 2)); i < (int)((cursor_width + 1) / 2); i++) {
+					for (int j = 0 - ((int)(cursor_width / 2)); j < (int)((cursor_width + 1) / 2); j++) {
+						glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int)* ((int)((xpos + i) / cell_size) + ((int)((ypos + j) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &one);
+					}
 				}
 			}
-		}
-		else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
-			glfwGetCursorPos(window, &xpos, &ypos);
-			for (int i = 0 - ((int)(cursor_width / 2)); i < (int)((cursor_width + 1) / 2); i++) {
-				for (int j = 0 - ((int)(cursor_width / 2)); j < (int)((cursor_width + 1) / 2); j++) {
-					glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((xpos + i) / cell_size) + ((int)((ypos + j) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &zero);
+			else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS) {
+				glfwGetCursorPos(window, &xpos, &ypos);
+				for (int i = 0 - ((int)(cursor_width / 2)); i < (int)((cursor_width + 1) / 2); i++) {
+					for (int j = 0 - ((int)(cursor_width / 2)); j < (int)((cursor_width + 1) / 2); j++) {
+						glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(unsigned int) * ((int)((xpos + i) / cell_size) + ((int)((ypos + j) / cell_size) * (window_width / cell_size))), sizeof(unsigned int), &zero);
+					}
 				}
 			}
 		}
@@ -487,11 +470,25 @@ int main() {
 		}
 
 		//check for events which occured since the last update
-		glfwPollEvents();
+		{
+			PROFILE_SCOPE("poll_events");
+			glfwPollEvents();
+		}
 		//swap our frame buffers
-		glfwSwapBuffers(window);
+		{
+			PROFILE_SCOPE("swap_buffers");
+			glfwSwapBuffers(window);
+		}
+
+		PROFILE_FRAME_END();
 	}
 
+	PROFILE_EXPORT_TRACE("trace.json");
+
+	//the gpu timers' queries have to be deleted while the context still exists
+	PROFILE_GPU_RELEASE(gpu_dispatch_timer);
+	PROFILE_GPU_RELEASE(gpu_draw_timer);
+
 
 
 	//termintate glfw and exit
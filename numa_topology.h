@@ -0,0 +1,128 @@
+//The functions defined here look up which logical cpus belong to which NUMA node and pin threads to them.
+//On a machine without NUMA (or where we can't find out) everything is reported as a single node holding every cpu.
+
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+struct NumaNode {
+    int id;
+    unsigned short group;       //processor group the cpus belong to (only meaningful on windows)
+    std::vector<int> cpus;      //logical cpu numbers (within the group on windows)
+};
+
+
+inline std::vector<NumaNode> single_numa_node() {
+    NumaNode node;
+    node.id = 0;
+    node.group = 0;
+    unsigned int cpu_count = std::thread::hardware_concurrency();
+    if (cpu_count == 0) {
+        cpu_count = 1;
+    }
+    for (unsigned int i = 0; i < cpu_count; i++) {
+        node.cpus.push_back((int)i);
+    }
+    return std::vector<NumaNode>(1, node);
+}
+
+#ifdef _WIN32
+inline std::vector<NumaNode> detect_numa_nodes() {
+    std::vector<NumaNode> nodes;
+    ULONG highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest)) {
+        return single_numa_node();
+    }
+    for (ULONG n = 0; n <= highest; n++) {
+        GROUP_AFFINITY affinity;
+        if (!GetNumaNodeProcessorMaskEx((USHORT)n, &affinity) || affinity.Mask == 0) {
+            continue;
+        }
+        NumaNode node;
+        node.id = (int)n;
+        node.group = affinity.Group;
+        for (int cpu = 0; cpu < (int)(sizeof(KAFFINITY) * 8); cpu++) {
+            if (affinity.Mask & ((KAFFINITY)1 << cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        nodes.push_back(node);
+    }
+    return nodes.empty() ? single_numa_node() : nodes;
+}
+
+//pins the calling thread to a single cpu of the given node
+inline bool pin_current_thread(const NumaNode& node, int cpu) {
+    GROUP_AFFINITY affinity = {};
+    affinity.Group = node.group;
+    affinity.Mask = (KAFFINITY)1 << cpu;
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL) != 0;
+}
+#else
+//parses a sysfs cpu list such as "0-7,16-23"
+inline std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream stream(list);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+inline std::vector<NumaNode> detect_numa_nodes() {
+    std::vector<NumaNode> nodes;
+    //node ids can have gaps, so just probe a reasonable range
+    for (int n = 0; n < 64; n++) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!file.is_open()) {
+            continue;
+        }
+        std::string list;
+        std::getline(file, list);
+        NumaNode node;
+        node.id = n;
+        node.group = 0;
+        node.cpus = parse_cpu_list(list);
+        //memory-only nodes have no cpus and can't run workers
+        if (!node.cpus.empty()) {
+            nodes.push_back(node);
+        }
+    }
+    return nodes.empty() ? single_numa_node() : nodes;
+}
+
+//pins the calling thread to a single cpu of the given node
+inline bool pin_current_thread(const NumaNode& node, int cpu) {
+    (void)node;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+#endif
+
+
+
+#endif
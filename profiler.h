@@ -0,0 +1,286 @@
+//The profiler defined here times the stages of the main loop (and anything else wrapped in PROFILE_SCOPE) so dropped frames can be traced back
+//to the stage that ate the time. Every thread records into its own fixed size event buffer without taking any locks, the main loop folds new
+//events into a rolling per-stage p50/p99 summary once per frame, and everything still buffered can be exported as a Chrome trace
+//(load it in chrome://tracing or https://ui.perfetto.dev).
+//
+//Profiling is compiled out unless ENABLE_PROFILING is defined before this header is included, in which case all of the macros below expand to nothing.
+//Define PROFILING_USE_RDTSC as well to timestamp with the cpu's time stamp counter instead of std::chrono::steady_clock.
+//GPU stages are timed with GL_TIME_ELAPSED queries, see gpu_timer.h.
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifdef ENABLE_PROFILING
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef PROFILING_USE_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+
+struct ProfileEvent {
+    const char* name;       //must be a string literal (or otherwise outlive the profiler), only the pointer is stored
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+//one slot of a ProfileEventBuffer. the fields are atomics because the owning thread can be overwriting a slot while the main thread copies it.
+struct ProfileEventSlot {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> start_ns;
+    std::atomic<uint64_t> duration_ns;
+};
+
+//single writer ring buffer. only the owning thread pushes, the main thread reads with read().
+//if a reader falls more than CAPACITY events behind, the oldest events are lost: read() drops every slot that may have been overwritten
+//while it was copying, so a lapped reader sees fewer events but never a torn one.
+class ProfileEventBuffer {
+public:
+    static const size_t CAPACITY = 1 << 16;
+
+    ProfileEventBuffer(const std::string& label, unsigned int track_id)
+        : label(label), track_id(track_id), slots(new ProfileEventSlot[CAPACITY]), write_index(0), summary_cursor(0) {
+    }
+
+    void push(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+        size_t index = write_index.load(std::memory_order_relaxed);
+        //pairs with the fence in read(): a reader that sees any of the stores below also sees write_index at index or later
+        std::atomic_thread_fence(std::memory_order_release);
+        ProfileEventSlot& slot = slots[index & (CAPACITY - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.start_ns.store(start_ns, std::memory_order_relaxed);
+        slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+        write_index.store(index + 1, std::memory_order_release);
+    }
+
+    //copies the events from index begin (or the oldest one still held, if that's later) up to write_index into out and returns the
+    //write_index it read up to. write_index is checked again after the copy, seqlock style, and any slot the owner could have started
+    //overwriting in the meantime is dropped from the front of out.
+    size_t read(size_t begin, std::vector<ProfileEvent>& out) const {
+        size_t end = write_index.load(std::memory_order_acquire);
+        if (end - begin > CAPACITY) {
+            begin = end - CAPACITY;
+        }
+        out.clear();
+        for (size_t i = begin; i < end; i++) {
+            const ProfileEventSlot& slot = slots[i & (CAPACITY - 1)];
+            ProfileEvent event = { slot.name.load(std::memory_order_relaxed), slot.start_ns.load(std::memory_order_relaxed),
+                slot.duration_ns.load(std::memory_order_relaxed) };
+            out.push_back(event);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        size_t written = write_index.load(std::memory_order_relaxed);
+        //while event written is being stored write_index still reads written, so slots up to and including that one can't be trusted
+        if (written >= begin + CAPACITY) {
+            size_t lost = written + 1 - CAPACITY - begin;
+            out.erase(out.begin(), out.begin() + (lost < out.size() ? lost : out.size()));
+        }
+        return end;
+    }
+
+    std::string label;
+    unsigned int track_id;
+    std::unique_ptr<ProfileEventSlot[]> slots;
+    std::atomic<size_t> write_index;
+    size_t summary_cursor;      //how far the rolling summary has read, only touched by the main thread
+};
+
+
+class Profiler {
+public:
+    static const size_t SUMMARY_WINDOW = 512;       //samples per stage kept for the rolling percentiles
+
+    static Profiler& instance() {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    //nanoseconds since the profiler was created
+    uint64_t now_ns() const {
+#ifdef PROFILING_USE_RDTSC
+        return (uint64_t)((double)(__rdtsc() - tsc_origin) * ns_per_tick);
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - clock_origin).count();
+#endif
+    }
+
+    //the calling thread's buffer, created the first time a thread records something
+    ProfileEventBuffer& thread_buffer() {
+        thread_local ProfileEventBuffer* buffer = nullptr;
+        if (buffer == nullptr) {
+            buffer = create_buffer("thread");
+        }
+        return *buffer;
+    }
+
+    //creates a buffer for a track that isn't a cpu thread, such as gpu timings
+    ProfileEventBuffer* create_buffer(const std::string& label) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        unsigned int track_id = (unsigned int)buffers.size();
+        buffers.push_back(std::unique_ptr<ProfileEventBuffer>(new ProfileEventBuffer(label + " " + std::to_string(track_id), track_id)));
+        return buffers.back().get();
+    }
+
+    //folds events recorded since the last call into the rolling summary and prints it every report_interval frames. call once per frame.
+    void frame_end(unsigned int report_interval = 240) {
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            for (size_t b = 0; b < buffers.size(); b++) {
+                ProfileEventBuffer& buffer = *buffers[b];
+                buffer.summary_cursor = buffer.read(buffer.summary_cursor, read_events);
+                for (size_t i = 0; i < read_events.size(); i++) {
+                    add_sample(read_events[i].name, read_events[i].duration_ns);
+                }
+            }
+        }
+
+        frames++;
+        if (report_interval > 0 && frames % report_interval == 0) {
+            print_summary();
+        }
+    }
+
+    void print_summary() {
+        std::cout << "--- frame " << frames << " stage timings (last " << SUMMARY_WINDOW << " samples, ms) ---\n";
+        for (std::map<std::string, StageSamples>::iterator it = stages.begin(); it != stages.end(); ++it) {
+            std::vector<uint64_t> sorted(it->second.samples.begin(), it->second.samples.begin() + it->second.count);
+            std::sort(sorted.begin(), sorted.end());
+            double p50 = sorted[(sorted.size() * 50) / 100] / 1e6;
+            double p99 = sorted[(sorted.size() * 99) / 100] / 1e6;
+            std::cout << it->first << ": p50 " << p50 << "  p99 " << p99 << "\n";
+        }
+    }
+
+    //writes every event still held in the buffers to a Chrome trace json file
+    bool export_chrome_trace(const char* path) {
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            std::cout << "ERROR::PROFILER::COULD_NOT_OPEN_TRACE_FILE: " << path << std::endl;
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        //chrome traces use microseconds. fixed notation keeps full precision however long the program has been running
+        //(the default would switch to 6 significant digits, i.e. millisecond resolution after a couple of minutes).
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        for (size_t b = 0; b < buffers.size(); b++) {
+            ProfileEventBuffer& buffer = *buffers[b];
+            file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer.track_id
+                << ",\"args\":{\"name\":\"" << buffer.label << "\"}}";
+            first = false;
+
+            buffer.read(0, read_events);
+            for (size_t i = 0; i < read_events.size(); i++) {
+                const ProfileEvent& event = read_events[i];
+                file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer.track_id
+                    << ",\"ts\":" << (event.start_ns / 1000.0) << ",\"dur\":" << (event.duration_ns / 1000.0) << "}";
+            }
+        }
+        file << "\n]}\n";
+        return true;
+    }
+
+private:
+    struct StageSamples {
+        std::vector<uint64_t> samples;
+        size_t next;
+        size_t count;
+    };
+
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<ProfileEventBuffer>> buffers;
+    std::map<std::string, StageSamples> stages;
+    std::vector<ProfileEvent> read_events;      //scratch for ProfileEventBuffer::read, guarded by registry_mutex
+    unsigned long long frames;
+#ifdef PROFILING_USE_RDTSC
+    uint64_t tsc_origin;
+    double ns_per_tick;
+#else
+    std::chrono::steady_clock::time_point clock_origin;
+#endif
+
+    Profiler() : frames(0) {
+#ifdef PROFILING_USE_RDTSC
+        //calibrate the time stamp counter against steady_clock over a short sleep
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t tsc_start = __rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t tsc_end = __rdtsc();
+        double elapsed_ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        ns_per_tick = elapsed_ns / (double)(tsc_end - tsc_start);
+        tsc_origin = __rdtsc();
+#else
+        clock_origin = std::chrono::steady_clock::now();
+#endif
+    }
+
+    void add_sample(const char* name, uint64_t duration_ns) {
+        StageSamples& stage = stages[name];
+        if (stage.samples.empty()) {
+            stage.samples.resize(SUMMARY_WINDOW);
+            stage.next = 0;
+            stage.count = 0;
+        }
+        stage.samples[stage.next] = duration_ns;
+        stage.next = (stage.next + 1) % SUMMARY_WINDOW;
+        if (stage.count < SUMMARY_WINDOW) {
+            stage.count++;
+        }
+    }
+};
+
+
+//records the time between its construction and destruction as one event on the current thread
+class ScopedProfileTimer {
+public:
+    ScopedProfileTimer(const char* name) : name(name), start_ns(Profiler::instance().now_ns()) {}
+
+    ~ScopedProfileTimer() {
+        Profiler& profiler = Profiler::instance();
+        uint64_t end_ns = profiler.now_ns();
+        profiler.thread_buffer().push(name, start_ns, end_ns - start_ns);
+    }
+
+private:
+    const char* name;
+    uint64_t start_ns;
+};
+
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_SCOPE(name) ScopedProfileTimer PROFILE_CONCAT(profile_timer_, __LINE__)(name)
+#define PROFILE_FRAME_END() Profiler::instance().frame_end()
+#define PROFILE_EXPORT_TRACE(path) Profiler::instance().export_chrome_trace(path)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME_END()
+#define PROFILE_EXPORT_TRACE(path)
+
+#endif
+
+
+
+#endif
@@ -0,0 +1,303 @@
+//The tile arena defined here hands out pairs of cell buffers for boards that are stepped on the cpu.
+//Each pair mirrors the cells_buff_1/cells_buff_2 setup in main.cpp: one buffer is read from while the next state is written into the other, and then they are swapped.
+//Pairs are carved out of 2MB slabs (backed by huge/large pages whenever the OS lets us) and released pairs go onto a free list,
+//so once an arena is warm, growing, shrinking or cloning a board never goes back to new/delete.
+
+#ifndef TILE_ARENA_H
+#define TILE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "advapi32.lib")     //AdjustTokenPrivileges, for large pages
+#endif
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+//two equally sized cell buffers. front holds the current board state and back receives the next one.
+struct TilePair {
+    unsigned int* front;
+    unsigned int* back;
+
+    void swap() {
+        unsigned int* temp = front;
+        front = back;
+        back = temp;
+    }
+};
+
+struct TileArenaStats {
+    size_t slab_count;
+    size_t huge_page_slabs;     //slabs that actually got huge/large pages (the rest fell back to normal pages)
+    size_t pairs_in_use;
+    size_t pairs_free;          //pairs sitting on the free list
+    size_t bytes_reserved;      //total size of all slabs
+    size_t bytes_in_use;
+    size_t bytes_free;          //bytes held by pairs on the free list, ready to be handed out again
+    size_t bytes_wasted;        //slab tails too small to hold another pair, which can never be handed out
+    double fragmentation;       //bytes_wasted as a fraction of bytes_reserved
+};
+
+
+class TileArena {
+public:
+    static const size_t SLAB_SIZE = 2 * 1024 * 1024;
+    static const size_t ALIGNMENT = 64;
+
+    //cells_per_tile is the number of cells in each buffer of a pair.
+    //numa_node selects which node the slabs are placed on, -1 leaves placement to first touch by the thread that grows the arena.
+    TileArena(size_t cells_per_tile, int numa_node = -1) : numa_node(numa_node) {
+        if (cells_per_tile == 0) {
+            std::cout << "ERROR::TILE_ARENA::EMPTY_TILES: cells_per_tile must be at least 1" << std::endl;
+            throw std::invalid_argument("TileArena: cells_per_tile must be at least 1");
+        }
+        buffer_bytes = round_up(cells_per_tile * sizeof(unsigned int), ALIGNMENT);
+        pair_bytes = 2 * buffer_bytes;
+        //pairs bigger than a slab get slabs of their own, rounded up to a whole number of huge pages
+        slab_bytes = pair_bytes > SLAB_SIZE ? round_up(pair_bytes, SLAB_SIZE) : SLAB_SIZE;
+        pairs_per_slab = slab_bytes / pair_bytes;
+        free_list = nullptr;
+        free_count = 0;
+        in_use_count = 0;
+        huge_page_slabs = 0;
+    }
+
+    ~TileArena() {
+        for (size_t i = 0; i < slabs.size(); i++) {
+            release_slab(slabs[i]);
+        }
+    }
+
+    TileArena(const TileArena&) = delete;
+    TileArena& operator=(const TileArena&) = delete;
+
+    //hands out a pair of zeroed buffers, growing the arena by one slab if the free list is empty
+    TilePair acquire() {
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        if (free_list == nullptr) {
+            grow();
+        }
+        FreeNode* node = free_list;
+        free_list = node->next;
+        free_count--;
+        in_use_count++;
+
+        unsigned char* base = reinterpret_cast<unsigned char*>(node);
+        std::memset(base, 0, pair_bytes);
+        TilePair tiles;
+        tiles.front = reinterpret_cast<unsigned int*>(base);
+        tiles.back = reinterpret_cast<unsigned int*>(base + buffer_bytes);
+        return tiles;
+    }
+
+    //returns a pair to the free list. either buffer of the pair may be passed as front, since pairs get swapped every step.
+    void release(TilePair tiles) {
+        unsigned char* base = reinterpret_cast<unsigned char*>(tiles.front < tiles.back ? tiles.front : tiles.back);
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        FreeNode* node = reinterpret_cast<FreeNode*>(base);
+        node->next = free_list;
+        free_list = node;
+        free_count++;
+        in_use_count--;
+    }
+
+    //makes sure at least pair_count pairs can be acquired without touching the OS allocator
+    void reserve(size_t pair_count) {
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        while (free_count < pair_count) {
+            grow();
+        }
+    }
+
+    TileArenaStats stats() {
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        TileArenaStats s;
+        s.slab_count = slabs.size();
+        s.huge_page_slabs = huge_page_slabs;
+        s.pairs_in_use = in_use_count;
+        s.pairs_free = free_count;
+        s.bytes_reserved = slabs.size() * slab_bytes;
+        s.bytes_in_use = in_use_count * pair_bytes;
+        s.bytes_free = free_count * pair_bytes;
+        s.bytes_wasted = slabs.size() * (slab_bytes - (pairs_per_slab * pair_bytes));
+        s.fragmentation = s.bytes_reserved > 0 ? (double)s.bytes_wasted / (double)s.bytes_reserved : 0.0;
+        return s;
+    }
+
+    void print_stats() {
+        TileArenaStats s = stats();
+        std::cout << "tile arena: " << s.slab_count << " slabs (" << s.huge_page_slabs << " huge page), "
+            << s.pairs_in_use << " pairs in use, " << s.pairs_free << " free, "
+            << (s.bytes_reserved / 1024) << " KB reserved, " << (s.bytes_free / 1024) << " KB free, "
+            << (s.bytes_wasted / 1024) << " KB wasted in slab tails (fragmentation " << (s.fragmentation * 100.0) << "%)\n";
+    }
+
+    size_t cells_per_buffer() const {
+        return buffer_bytes / sizeof(unsigned int);
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct Slab {
+        unsigned char* memory;
+        size_t mapped_bytes;
+        bool huge_pages;
+    };
+
+    int numa_node;
+    size_t buffer_bytes;
+    size_t pair_bytes;
+    size_t slab_bytes;
+    size_t pairs_per_slab;
+
+    std::vector<Slab> slabs;
+    FreeNode* free_list;
+    size_t free_count;
+    size_t in_use_count;
+    size_t huge_page_slabs;
+    std::mutex arena_mutex;
+
+    static size_t round_up(size_t value, size_t multiple) {
+        return ((value + multiple - 1) / multiple) * multiple;
+    }
+
+    //maps one more slab and threads all of its pairs onto the free list. caller must hold arena_mutex.
+    void grow() {
+        Slab slab = map_slab();
+        if (slab.memory == nullptr) {
+            std::cout << "ERROR::TILE_ARENA::SLAB_ALLOCATION_FAILED: " << slab_bytes << " bytes" << std::endl;
+            throw std::bad_alloc();
+        }
+        //touch every page now so page faults happen here rather than during a generation, and so first touch places the slab on this thread's node
+        std::memset(slab.memory, 0, slab_bytes);
+
+        if (slab.huge_pages) {
+            huge_page_slabs++;
+        }
+        slabs.push_back(slab);
+
+        for (size_t i = pairs_per_slab; i > 0; i--) {
+            FreeNode* node = reinterpret_cast<FreeNode*>(slab.memory + ((i - 1) * pair_bytes));
+            node->next = free_list;
+            free_list = node;
+            free_count++;
+        }
+    }
+
+#ifdef _WIN32
+    //large pages need SeLockMemoryPrivilege ("Lock pages in memory"), which has to be granted to the user by policy and then
+    //enabled on the process token. returns false if the user doesn't hold it, in which case we stick to normal pages.
+    static bool enable_large_page_privilege() {
+        static bool enabled = false;
+        static bool attempted = false;
+        static std::mutex privilege_mutex;
+        std::lock_guard<std::mutex> lock(privilege_mutex);
+        if (attempted) {
+            return enabled;
+        }
+        attempted = true;
+
+        HANDLE token;
+        if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+            return false;
+        }
+        TOKEN_PRIVILEGES privileges;
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid)) {
+            //AdjustTokenPrivileges succeeds even when the privilege isn't held, so the last error has to be checked as well
+            enabled = AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) && GetLastError() == ERROR_SUCCESS;
+        }
+        CloseHandle(token);
+        if (!enabled) {
+            std::cout << "tile arena: SeLockMemoryPrivilege not available, using normal pages" << std::endl;
+        }
+        return enabled;
+    }
+
+    Slab map_slab() {
+        Slab slab = { nullptr, slab_bytes, false };
+        DWORD node = numa_node >= 0 ? (DWORD)numa_node : NUMA_NO_PREFERRED_NODE;
+
+        SIZE_T large_page = GetLargePageMinimum();
+        if (large_page != 0 && slab_bytes % large_page == 0 && enable_large_page_privilege()) {
+            slab.memory = (unsigned char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, slab_bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, node);
+            slab.huge_pages = slab.memory != nullptr;
+        }
+        if (slab.memory == nullptr) {
+            slab.memory = (unsigned char*)VirtualAllocExNuma(GetCurrentProcess(), NULL, slab_bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+        }
+        return slab;
+    }
+
+    void release_slab(Slab& slab) {
+        VirtualFree(slab.memory, 0, MEM_RELEASE);
+    }
+#else
+    Slab map_slab() {
+        Slab slab = { nullptr, slab_bytes, false };
+
+        //explicit huge pages only work if the admin has reserved some (vm.nr_hugepages), so this often fails
+        void* memory = mmap(NULL, slab_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            slab.memory = (unsigned char*)memory;
+            slab.huge_pages = true;
+        }
+        else {
+            //otherwise over-map so we can trim to a 2MB aligned range, which transparent huge pages need to kick in
+            size_t padded = slab_bytes + SLAB_SIZE;
+            memory = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                return slab;
+            }
+            uintptr_t start = (uintptr_t)memory;
+            uintptr_t aligned = round_up(start, SLAB_SIZE);
+            if (aligned > start) {
+                munmap(memory, aligned - start);
+            }
+            if ((start + padded) > (aligned + slab_bytes)) {
+                munmap((void*)(aligned + slab_bytes), (start + padded) - (aligned + slab_bytes));
+            }
+            slab.memory = (unsigned char*)aligned;
+#ifdef MADV_HUGEPAGE
+            madvise(slab.memory, slab_bytes, MADV_HUGEPAGE);
+#endif
+        }
+
+#ifdef SYS_mbind
+        //bind to the requested node before the first touch. we call the syscall directly so we don't need to link libnuma.
+        //if this fails (no NUMA support, bad node) the memset in grow() still places the slab by first touch.
+        if (numa_node >= 0 && numa_node < 64) {
+            const int MPOL_BIND_MODE = 2;
+            unsigned long node_mask = 1UL << numa_node;
+            syscall(SYS_mbind, slab.memory, slab_bytes, MPOL_BIND_MODE, &node_mask, sizeof(node_mask) * 8, 0);
+        }
+#endif
+        return slab;
+    }
+
+    void release_slab(Slab& slab) {
+        munmap(slab.memory, slab.mapped_bytes);
+    }
+#endif
+};
+
+
+
+#endif
@@ -0,0 +1,86 @@
+//Standalone linux build of the differential check, including the cell_solver.computes engine. Instead of a window it makes a surfaceless
+//EGL context, so it runs on machines with no display and, with Mesa's llvmpipe, without a gpu at all. GLEW isn't needed, the GL entry
+//points come straight from libOpenGL. From the repository root:
+//
+//  g++ -std=c++11 -O2 -pthread -DNO_GLEW tools/differential_check_egl.cpp -lEGL -lOpenGL -o differential_check_egl
+//  LIBGL_ALWAYS_SOFTWARE=1 ./differential_check_egl [shader path] [cases] [seed]
+//
+//The exit code is 0 only if every engine matched the reference on every case.
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "../differential_check.h"
+#include "../gpu_engine.h"
+
+
+//surfaceless display if Mesa offers one, the default display otherwise
+EGLDisplay open_display() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (get_platform_display != NULL) {
+		EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+			return display;
+		}
+	}
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) {
+		return display;
+	}
+	return EGL_NO_DISPLAY;
+}
+
+int main(int argc, char** argv) {
+	const char* shader_path = argc > 1 ? argv[1] : "shaders/cell_solver.computes";
+	unsigned int case_count = argc > 2 ? (unsigned int)std::strtoul(argv[2], NULL, 10) : 200;
+	uint64_t seed = argc > 3 ? std::strtoull(argv[3], NULL, 10) : 1;
+
+	//---------------------------------------------------------------------------------------------------
+	//EGL INITILIZATION. A GL 4.3 CORE CONTEXT WITH NO SURFACE, THE SHADER ONLY WRITES TO BUFFERS AND AN IMAGE.
+	//---------------------------------------------------------------------------------------------------
+	EGLDisplay display = open_display();
+	if (display == EGL_NO_DISPLAY) {
+		std::cout << "ERROR: Could not initialize egl!\n";
+		return 1;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "ERROR: egl has no desktop GL support!\n";
+		return 1;
+	}
+
+	//surfaceless displays have no window configs, which is what eglChooseConfig asks for by default
+	const EGLint config_attributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config;
+	EGLint config_count = 0;
+	if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+		std::cout << "ERROR: No egl config with desktop GL!\n";
+		return 1;
+	}
+
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cout << "ERROR: Could not create a GL 4.3 core context!\n";
+		return 1;
+	}
+	std::cout << "GL " << glGetString(GL_VERSION) << " on " << glGetString(GL_RENDERER) << "\n";
+
+	std::vector<DifferentialEngine> engines = cpu_differential_engines();
+	engines.push_back(gpu_compute_engine(shader_path));
+	unsigned int failures = run_differential_check(engines, case_count, seed);
+	std::cout << "differential check: " << failures << " mismatches\n";
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+	eglTerminate(display);
+	return failures == 0 ? 0 : 1;
+}